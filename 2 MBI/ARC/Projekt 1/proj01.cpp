@@ -18,7 +18,19 @@
 
 #include <string.h>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <ios>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
 
 #include <omp.h>
 #include <hdf5.h>
@@ -44,6 +56,242 @@ float * parResult = NULL;
 /// Parameters of the simulation
 TParameters parameters;
 
+/// Rectangular region of the domain
+struct TRegion
+{
+    /// Position of the top left corner (column, row)
+    size_t x, y;
+    /// Size of the region
+    size_t width, height;
+};
+
+/**
+ * Parameters of the simulation not covered by ParseCommandline. They are
+ * given as long options (--name value) and removed from argv before the
+ * standard command line is parsed.
+ */
+struct TExtendedParameters
+{
+    /// Number of threads writing one snapshot (1 = single writer using H5Dwrite)
+    size_t nWriterThreads;
+
+    /// Regions of interest stored instead of the whole domain
+    vector<TRegion> regions;
+    /// Decimation factor of the stored overview (0 = no overview)
+    size_t          decimation;
+    /// Probe points stored in every snapshot (width and height are not used)
+    vector<TRegion> probes;
+
+    /// Run the calibration sweep and store the best configuration into the profile
+    bool   autotune;
+    /// Load the best configuration from the profile
+    bool   tuned;
+    /// Profile with the tuned configurations (empty = per-host default)
+    string profileFileName;
+    /// Calibration run of the autotuner, the batch line is not printed
+    bool   quiet;
+
+    /// Store snapshots into the raw binary stream instead of hdf5
+    bool   rawOutput;
+
+    /// Verify against this golden file instead of running the sequential version
+    string goldenFileName;
+    /// Store the result of the sequential version as a golden file
+    string storeGoldenFileName;
+
+    /// Publish live metrics into this file (empty = no metrics)
+    string metricsFileName;
+
+    TExtendedParameters() : nWriterThreads(1), decimation(0), autotune(false), tuned(false),
+                            quiet(false), rawOutput(false) {}
+
+    /// Is only a part of the domain stored in the snapshots?
+    bool IsReducedOutput() const
+    {
+        return !regions.empty() || (decimation > 0) || !probes.empty();
+    }
+
+    /// Do all the regions and probes lie inside the domain?
+    bool FitsDomain(const size_t edgeSize) const
+    {
+        for (size_t r = 0; r < regions.size(); r++)
+            if ((regions[r].x + regions[r].width > edgeSize) || (regions[r].y + regions[r].height > edgeSize))
+                return false;
+
+        for (size_t p = 0; p < probes.size(); p++)
+            if ((probes[p].x >= edgeSize) || (probes[p].y >= edgeSize))
+                return false;
+
+        return decimation < edgeSize;
+    }
+};
+
+/// Extended parameters of the simulation
+TExtendedParameters extParameters;
+
+/// Alignment of the header, the snapshots and the index in the raw stream
+#define RAW_ALIGNMENT 4096
+
+/// Header at the beginning of the raw stream
+struct TRawHeader
+{
+    /// "HEATRAW1"
+    char     magic[8];
+    /// Size of the domain
+    uint64_t edgeSize;
+    /// Alignment of the snapshots
+    uint64_t alignment;
+    /// Distance of two snapshots in the stream
+    uint64_t snapshotStride;
+};
+
+/// One record of the index at the end of the raw stream
+struct TRawIndexEntry
+{
+    /// Iteration of the snapshot
+    uint64_t iteration;
+    /// Position of the snapshot in the stream
+    uint64_t offset;
+};
+
+/// Footer closing the raw stream (the last bytes of the file)
+struct TRawFooter
+{
+    /// Position of the index
+    uint64_t indexOffset;
+    /// Number of snapshots
+    uint64_t nSnapshots;
+    /// "HEATIDX1"
+    char     magic[8];
+};
+
+/// Raw append-only snapshot stream open for writing
+struct TRawStream
+{
+    /// File descriptor (-1 = not open)
+    int                    fd;
+    /// Size of the domain
+    size_t                 edgeSize;
+    /// Distance of two snapshots in the stream
+    size_t                 snapshotStride;
+    /// Where the next snapshot goes
+    off_t                  endOffset;
+    /// Snapshots written so far
+    vector<TRawIndexEntry> index;
+
+    TRawStream() : fd(-1), edgeSize(0), snapshotStride(0), endOffset(0) {}
+};
+
+/// Maximum absolute error accepted by the verification
+#define VERIFICATION_EPSILON 0.001f
+/// Domains up to this size are printed whole in the debug mode
+#define PRINT_ARRAY_LIMIT    32
+/// Half size of the window printed around the worst point in the debug mode
+#define PRINT_WINDOW_RADIUS  4
+
+/// Comparison of the parallel result with the reference
+struct TVerificationReport
+{
+    /// Maximum absolute error
+    float    maxAbsError;
+    /// Maximum relative error
+    float    maxRelError;
+    /// Maximum distance in units in the last place
+    uint32_t maxUlpDistance;
+    /// Position of the point with the maximum absolute error
+    size_t   worstRow, worstCol;
+    /// Number of points where the result or the reference is NaN or Inf
+    size_t   nNonFinite;
+};
+
+/// Number of iterations of one calibration run of the autotuner
+#define AUTOTUNE_ITERATIONS 100
+/// Slowdown tolerated by the autotuner when looking for the densest file output
+#define AUTOTUNE_TOLERANCE  1.05
+
+/// The fastest configuration of the parallel simulation for a given domain
+struct TTunedConfiguration
+{
+    /// Size of the domain
+    size_t edgeSize;
+    /// Was the configuration tuned with file output?
+    bool   fileOutput;
+    /// Use the overlapped version
+    bool   overlapped;
+    /// Number of threads
+    size_t nThreads;
+    /// Disk write intensity
+    size_t diskWriteIntensity;
+    /// Number of writer threads
+    size_t nWriterThreads;
+    /// Measured time of one iteration
+    double iterationTime;
+};
+
+/// Default period of sampling by the metrics reader [ms]
+#define METRICS_SAMPLING_PERIOD 1000
+
+/// State of the publisher of the metrics
+enum TMetricsState
+{
+    /// No version of the simulation is running
+    METRICS_IDLE    = 0,
+    /// A version of the simulation is running
+    METRICS_RUNNING = 1,
+    /// The simulation has finished, nothing more will be published
+    METRICS_CLOSED  = 2
+};
+
+/// One sample of the live metrics
+struct TMetricsSample
+{
+    /// Running version of the simulation (seq, par1, par2)
+    char     version[8];
+    /// Process id of the publisher
+    int64_t  pid;
+    /// TMetricsState
+    uint32_t state;
+    /// Number of snapshots handed over but not written yet
+    uint32_t ioQueueDepth;
+    /// Number of finished iterations
+    uint64_t iteration;
+    /// Number of iterations of the simulation
+    uint64_t nIterations;
+    /// Average speed since the start of the version
+    double   iterationsPerSecond;
+    /// Average temperature in the middle column
+    double   middleColAvgTemp;
+    /// Snapshot data written into the output file
+    uint64_t bytesWritten;
+};
+
+/// Memory mapped metrics file, the sample is guarded by a seqlock
+struct TMetricsSegment
+{
+    /// "HEATMET1"
+    char           magic[8];
+    /// Sequence of the seqlock, odd while the sample is being updated
+    uint64_t       sequence;
+    /// Last published sample
+    TMetricsSample sample;
+};
+
+/// Publisher of the live metrics (one thread only)
+struct TMetricsPublisher
+{
+    /// Mapped metrics file (NULL = metrics are not published)
+    TMetricsSegment * segment;
+    /// Local copy of the sample
+    TMetricsSample    sample;
+    /// Start of the running version
+    double            startTime;
+
+    TMetricsPublisher() : segment(NULL), startTime(0.0) {}
+};
+
+/// Publisher of the live metrics of this simulation
+TMetricsPublisher metricsPublisher;
+
 
 //----------------------------------------------------------------------------//
 //------------------------- Function declarations ----------------------------//
@@ -74,6 +322,163 @@ void StoreDataIntoFile(hid_t         h5fileId,
                        const size_t  snapshotId,
                        const size_t  iteration);
 
+/// Create a snapshot with preallocated storage for direct parallel writes
+haddr_t CreateDirectSnapshot(hid_t        h5fileId,
+                             const size_t edgeSize,
+                             const size_t snapshotId,
+                             const size_t iteration);
+
+/// Write a band of rows of the snapshot directly into the output file
+void StoreRowsIntoFile(int           fileDescriptor,
+                       haddr_t       dataOffset,
+                       const float * data,
+                       const size_t  edgeSize,
+                       const size_t  bandId,
+                       const size_t  nBands);
+
+/// Get the file descriptor of an open hdf5 file
+int GetFileDescriptor(hid_t h5fileId);
+
+/// Number of values stored in one reduced snapshot
+size_t GetReducedSnapshotSize(const TExtendedParameters & extParameters,
+                              const size_t                edgeSize);
+
+/// Copy the parts of one row needed by the reduced snapshot
+void ExtractReducedRow(const float *               data,
+                       float *                     reducedData,
+                       const TExtendedParameters & extParameters,
+                       const size_t                edgeSize,
+                       const size_t                row);
+
+/// Store reduced time step (regions, overview and probes) into output file
+void StoreReducedDataIntoFile(hid_t                       h5fileId,
+                              const float *               reducedData,
+                              const TExtendedParameters & extParameters,
+                              const size_t                edgeSize,
+                              const size_t                snapshotId,
+                              const size_t                iteration);
+
+/// Create a float dataset in the group and write the data into it
+hid_t CreateAndWriteDataset(hid_t           groupId,
+                            const string &  datasetName,
+                            const float *   data,
+                            const int       rank,
+                            const hsize_t * dims,
+                            H5D_layout_t    layout);
+
+/// Write an attribute with positions (array of unsigned integers)
+void WritePositionAttribute(hid_t                      objectId,
+                            const string &             attributeName,
+                            const unsigned long long * positions,
+                            const int                  rank,
+                            const hsize_t *            dims);
+
+/// Create a raw snapshot stream
+void CreateRawStream(TRawStream   & rawStream,
+                     const string & fileName,
+                     const size_t   edgeSize);
+
+/// Reserve space for the next snapshot in the raw stream
+off_t ReserveRawSnapshot(TRawStream & rawStream,
+                         const size_t iteration);
+
+/// Append time step to the raw stream
+void StoreDataIntoRawStream(TRawStream  & rawStream,
+                            const float * data,
+                            const size_t  iteration);
+
+/// Write the index and close the raw stream
+void CloseRawStream(TRawStream & rawStream);
+
+/// Map a raw stream into memory for reading
+const char * MapRawStream(const string & fileName,
+                          size_t       & fileSize);
+
+/// Convert a raw stream into the hdf5 (Pixie) format
+void ConvertRawStream(const string & rawFileName,
+                      const string & h5FileName);
+
+/// Compare the result with the reference (parallel and vectorized)
+TVerificationReport CompareResults(const float * reference,
+                                   const float * result,
+                                   const size_t  edgeSize);
+
+/// Print a window of the domain around the given point
+void PrintWindow(const float * data,
+                 const size_t  edgeSize,
+                 const size_t  centerRow,
+                 const size_t  centerCol);
+
+/// Store the final temperature as a golden file
+void StoreGoldenFile(const string & fileName,
+                     const float  * data,
+                     const size_t   edgeSize,
+                     const size_t   nIterations);
+
+/// Load the final temperature from a golden file
+void LoadGoldenFile(const string & fileName,
+                    float        * data,
+                    const size_t   edgeSize,
+                    const size_t   nIterations);
+
+/// Run short calibration sweeps and find the fastest configuration
+TTunedConfiguration AutotuneConfiguration(const TMaterialProperties & materialProperties,
+                                          const TParameters         & parameters);
+
+/// Measure the time of one iteration of the given configuration
+double MeasureConfiguration(const TMaterialProperties & materialProperties,
+                            const TParameters         & parameters,
+                            const TTunedConfiguration & configuration,
+                            const string              & calibrationFileName);
+
+/// Load the tuned configuration for the domain from the profile
+bool LoadTunedConfiguration(const string        & profileFileName,
+                            const size_t          edgeSize,
+                            const bool            fileOutput,
+                            TTunedConfiguration & configuration);
+
+/// Store the tuned configuration into the profile
+void StoreTunedConfiguration(const string              & profileFileName,
+                             const TTunedConfiguration & configuration);
+
+/// Name of the per-host profile file
+string GetProfileFileName(const TExtendedParameters & extParameters);
+
+/// Create the metrics file and map it into memory
+void CreateMetrics(TMetricsPublisher & publisher,
+                   const string      & fileName);
+
+/// Publish the start of a version of the simulation
+void StartMetrics(TMetricsPublisher & publisher,
+                  const char        * version,
+                  const size_t        nIterations);
+
+/// Publish the progress of the running version
+void PublishMetrics(TMetricsPublisher & publisher,
+                    const size_t        iteration,
+                    const float         middleColAvgTemp,
+                    const size_t        ioQueueDepth,
+                    const size_t        bytesWritten);
+
+/// Publish the end of the running version
+void StopMetrics(TMetricsPublisher & publisher);
+
+/// Publish the end of the simulation and unmap the metrics file
+void CloseMetrics(TMetricsPublisher & publisher);
+
+/// Copy the sample into the metrics file under the seqlock
+void WriteMetricsSample(TMetricsSegment      * segment,
+                        const TMetricsSample & sample);
+
+/// Print samples from the metrics file of a running simulation
+void ReadMetrics(const string & fileName,
+                 const size_t   samplingPeriod);
+
+/// Parse extended parameters and remove them from argv
+void ParseExtendedCommandline(int &                 argc,
+                              char *                argv[],
+                              TExtendedParameters & extParameters);
+
 
 //----------------------------------------------------------------------------//
 //------------------------- Function implementation  -------------------------//
@@ -96,6 +501,7 @@ void SequentialHeatDistribution(float *                     seqResult,
 
     // [1] Create a new output hdf5 file
     hid_t file_id = H5I_INVALID_HID;
+    TRawStream rawStream;
 
     if (outputFileName != "")
     {
@@ -104,13 +510,22 @@ void SequentialHeatDistribution(float *                     seqResult,
         else
             outputFileName.insert(outputFileName.find_last_of("."), "_seq");
 
-        file_id = H5Fcreate(outputFileName.c_str(),
-                            H5F_ACC_TRUNC,
-                            H5P_DEFAULT,
-                            H5P_DEFAULT);
-        if (file_id < 0)
-            throw(ios::failure("Cannot create output file"));
+        if (extParameters.rawOutput)
+        {
+            outputFileName.replace(outputFileName.find_last_of("."), string::npos, ".raw");
+            CreateRawStream(rawStream, outputFileName, materialProperties.edgeSize);
+        }
+        else
+        {
+            file_id = H5Fcreate(outputFileName.c_str(),
+                                H5F_ACC_TRUNC,
+                                H5P_DEFAULT,
+                                H5P_DEFAULT);
+            if (file_id < 0)
+                throw(ios::failure("Cannot create output file"));
+        }
     }
+    const bool fileOutput = (file_id != H5I_INVALID_HID) || (rawStream.fd >= 0);
 
 
     // [2] A temporary array is needed to prevent mixing of data form step t and t+1
@@ -129,11 +544,20 @@ void SequentialHeatDistribution(float *                     seqResult,
     // t - values
     float * oldTemp = tempArray;
 
+    // Regions, overview and probes gathered for a reduced snapshot
+    vector<float> reducedData(GetReducedSnapshotSize(extParameters, materialProperties.edgeSize));
+
+    // Size of one snapshot and data written so far (live metrics)
+    const size_t snapshotSize = (extParameters.IsReducedOutput() ? reducedData.size()
+                                                                 : materialProperties.nGridPoints) * sizeof(float);
+    size_t bytesWritten = 0;
+
     if (!parameters.batchMode)
         printf("Starting sequential simulation... \n");
 
     //---------------------- [5] press the stop watch ------------------------------//
     double elapsedTime = omp_get_wtime();
+    StartMetrics(metricsPublisher, "seq", parameters.nIterations);
     size_t i, j;
     size_t iteration, printCounter = 1;
     float middleColAvgTemp = 0.0f;
@@ -202,13 +626,34 @@ void SequentialHeatDistribution(float *                     seqResult,
         middleColAvgTemp /= materialProperties.edgeSize;
 
         // [8] Store time step in the output file if necessary
-        if ((file_id != H5I_INVALID_HID)  && ((iteration % parameters.diskWriteIntensity) == 0))
+        if (fileOutput && ((iteration % parameters.diskWriteIntensity) == 0))
         {
-            StoreDataIntoFile(file_id,
-                              newTemp,
-                              materialProperties.edgeSize,
-                              iteration / parameters.diskWriteIntensity,
-                              iteration);
+            if (rawStream.fd >= 0)
+            {
+                StoreDataIntoRawStream(rawStream, newTemp, iteration);
+            }
+            else if (extParameters.IsReducedOutput())
+            {
+                for (i = 0; i < materialProperties.edgeSize; i++)
+                    ExtractReducedRow(newTemp, reducedData.data(), extParameters,
+                                      materialProperties.edgeSize, i);
+
+                StoreReducedDataIntoFile(file_id,
+                                         reducedData.data(),
+                                         extParameters,
+                                         materialProperties.edgeSize,
+                                         iteration / parameters.diskWriteIntensity,
+                                         iteration);
+            }
+            else
+            {
+                StoreDataIntoFile(file_id,
+                                  newTemp,
+                                  materialProperties.edgeSize,
+                                  iteration / parameters.diskWriteIntensity,
+                                  iteration);
+            }
+            bytesWritten += snapshotSize;
         }
 
         // [9] Swap new and old values
@@ -224,12 +669,15 @@ void SequentialHeatDistribution(float *                     seqResult,
             ++printCounter;
         }
 
+        // [11] Publish live metrics
+        PublishMetrics(metricsPublisher, iteration + 1, middleColAvgTemp, 0, bytesWritten);
     }// for iteration
 
     //-------------------- stop the stop watch  --------------------------------//
     double totalTime = omp_get_wtime() - elapsedTime;
+    StopMetrics(metricsPublisher);
 
-    // [11] Print final result
+    // [12] Print final result
     if (!parameters.batchMode)
         printf("\nExecution time of sequential version: %.5fs\n", totalTime);
     else
@@ -239,8 +687,9 @@ void SequentialHeatDistribution(float *                     seqResult,
 
     // Close the output file
     if (file_id != H5I_INVALID_HID) H5Fclose(file_id);
+    if (rawStream.fd >= 0) CloseRawStream(rawStream);
 
-    // [12] Return correct results in the correct array
+    // [13] Return correct results in the correct array
     if (iteration & 1)
     {
         memcpy(seqResult, tempArray, materialProperties.nGridPoints * sizeof(float));
@@ -270,6 +719,7 @@ void ParallelHeatDistributionNonOverlapped(float *                     parResult
 {
     // Create a new output hdf5 file
     hid_t file_id = H5I_INVALID_HID;
+    TRawStream rawStream;
 
     if (outputFileName != "")
     {
@@ -278,13 +728,39 @@ void ParallelHeatDistributionNonOverlapped(float *                     parResult
         else
             outputFileName.insert(outputFileName.find_last_of("."), "_par1");
 
-        file_id = H5Fcreate(outputFileName.c_str(),
-                            H5F_ACC_TRUNC,
-                            H5P_DEFAULT,
-                            H5P_DEFAULT);
-        if (file_id < 0)
-            throw(ios::failure("Cannot create output file"));
+        if (extParameters.rawOutput)
+        {
+            outputFileName.replace(outputFileName.find_last_of("."), string::npos, ".raw");
+            CreateRawStream(rawStream, outputFileName, materialProperties.edgeSize);
+        }
+        else
+        {
+            file_id = H5Fcreate(outputFileName.c_str(),
+                                H5F_ACC_TRUNC,
+                                H5P_DEFAULT,
+                                H5P_DEFAULT);
+            if (file_id < 0)
+                throw(ios::failure("Cannot create output file"));
+        }
     }
+    const bool fileOutput = (file_id != H5I_INVALID_HID) || (rawStream.fd >= 0);
+
+    // Parallel writer: snapshot data bypass the library and go directly into the file
+    const bool parallelWriter = (extParameters.nWriterThreads > 1) && !extParameters.IsReducedOutput();
+    int        fileDescriptor = -1;
+    haddr_t    snapshotOffset = HADDR_UNDEF;
+    if (fileOutput && parallelWriter)
+        fileDescriptor = (rawStream.fd >= 0) ? rawStream.fd : GetFileDescriptor(file_id);
+
+    // Regions, overview and probes gathered for a reduced snapshot
+    float * reducedData = (float *) _mm_malloc(GetReducedSnapshotSize(extParameters, materialProperties.edgeSize) *
+                                               sizeof(float), DATA_ALIGNMENT);
+
+    // Size of one snapshot and data written so far (live metrics)
+    const size_t snapshotSize = (extParameters.IsReducedOutput()
+                                 ? GetReducedSnapshotSize(extParameters, materialProperties.edgeSize)
+                                 : materialProperties.nGridPoints) * sizeof(float);
+    size_t bytesWritten = 0;
 
     // we need a temporary array to prevent mixing of data form step t and t+1
     float * tempArray = (float *) _mm_malloc(materialProperties.nGridPoints * sizeof(float),
@@ -298,6 +774,7 @@ void ParallelHeatDistributionNonOverlapped(float *                     parResult
         printf("\nStarting parallel simulation (non-overlapped) ... \n");
     //---------------------- prest the stop watch ------------------------------//
     double elapsedTime = omp_get_wtime();
+    StartMetrics(metricsPublisher, "par1", parameters.nIterations);
     size_t i, j;
     size_t iteration, printCounter = 1;
     float middleColAvgTemp = 0.0f;
@@ -379,18 +856,67 @@ void ParallelHeatDistributionNonOverlapped(float *                     parResult
                                             materialProperties.edgeSize/2];
             }
 
+            // Store time step in the output file by the team, each band of rows
+            // is written by one thread
+            if (fileOutput && parallelWriter &&
+                ((iteration % parameters.diskWriteIntensity) == 0))
+            {
+                #pragma omp single
+                {
+                    snapshotOffset = (rawStream.fd >= 0)
+                                     ? ReserveRawSnapshot(rawStream, iteration)
+                                     : CreateDirectSnapshot(file_id,
+                                                            materialProperties.edgeSize,
+                                                            iteration / parameters.diskWriteIntensity,
+                                                            iteration);
+                }
+
+                #pragma omp for schedule(static, 1)
+                for (size_t band = 0; band < extParameters.nWriterThreads; band++)
+                {
+                    StoreRowsIntoFile(fileDescriptor,
+                                      snapshotOffset,
+                                      newTemp,
+                                      materialProperties.edgeSize,
+                                      band, extParameters.nWriterThreads);
+                }
+            }
+
+            // Gather the parts of the reduced snapshot by the team
+            if (fileOutput && extParameters.IsReducedOutput() &&
+                ((iteration % parameters.diskWriteIntensity) == 0))
+            {
+                #pragma omp for firstprivate(newTemp)
+                for (i = 0; i < materialProperties.edgeSize; i++)
+                {
+                    ExtractReducedRow(newTemp, reducedData, extParameters,
+                                      materialProperties.edgeSize, i);
+                }
+            }
+
             #pragma omp master
             {
 
                 middleColAvgTemp /= materialProperties.edgeSize;
 
                 // Store time step in the output file if necessary
-                if ((file_id != H5I_INVALID_HID) && ((iteration % parameters.diskWriteIntensity) == 0)) {
-                    StoreDataIntoFile(file_id,
-                                      newTemp,
-                                      materialProperties.edgeSize,
-                                      iteration / parameters.diskWriteIntensity,
-                                      iteration);
+                if (fileOutput && !parallelWriter &&
+                    ((iteration % parameters.diskWriteIntensity) == 0)) {
+                    if (rawStream.fd >= 0)
+                        StoreDataIntoRawStream(rawStream, newTemp, iteration);
+                    else if (extParameters.IsReducedOutput())
+                        StoreReducedDataIntoFile(file_id,
+                                                 reducedData,
+                                                 extParameters,
+                                                 materialProperties.edgeSize,
+                                                 iteration / parameters.diskWriteIntensity,
+                                                 iteration);
+                    else
+                        StoreDataIntoFile(file_id,
+                                          newTemp,
+                                          materialProperties.edgeSize,
+                                          iteration / parameters.diskWriteIntensity,
+                                          iteration);
                 }
 
                 // swap new and old values
@@ -403,6 +929,11 @@ void ParallelHeatDistributionNonOverlapped(float *                     parResult
                            middleColAvgTemp);
                     ++printCounter;
                 }
+
+                // publish live metrics, the snapshot has already been written
+                if (fileOutput && ((iteration % parameters.diskWriteIntensity) == 0))
+                    bytesWritten += snapshotSize;
+                PublishMetrics(metricsPublisher, iteration + 1, middleColAvgTemp, 0, bytesWritten);
             }
             #pragma omp barrier
         }// for iteration
@@ -413,10 +944,11 @@ void ParallelHeatDistributionNonOverlapped(float *                     parResult
     //--------------------------------------------------------------------------//
 
     double totalTime = omp_get_wtime() - elapsedTime;
+    StopMetrics(metricsPublisher);
 
     if (!parameters.batchMode)
         printf("\nExecution time of parallel (non-overlapped) version: %.5fs\n", totalTime);
-    else
+    else if (!extParameters.quiet)
         printf("%s;%s;%f;%e;%e\n", outputFileName.c_str(), "par1",
                middleColAvgTemp, totalTime,
                totalTime / parameters.nIterations);
@@ -425,6 +957,7 @@ void ParallelHeatDistributionNonOverlapped(float *                     parResult
 
     // Close the output file
     if (file_id != H5I_INVALID_HID) H5Fclose(file_id);
+    if (rawStream.fd >= 0) CloseRawStream(rawStream);
 
     // return correct results in the correct array
     if (parameters.nIterations & 1)
@@ -433,6 +966,7 @@ void ParallelHeatDistributionNonOverlapped(float *                     parResult
     }
 
     _mm_free(tempArray);
+    _mm_free(reducedData);
 }// end of ParallelHeatDistribution
 //------------------------------------------------------------------------------
 
@@ -458,6 +992,7 @@ void ParallelHeatDistributionOverlapped(float *                     parResult,
 {
     // Create a new output hdf5 file
     hid_t file_id = H5I_INVALID_HID;
+    TRawStream rawStream;
 
     if (outputFileName != "")
     {
@@ -466,20 +1001,45 @@ void ParallelHeatDistributionOverlapped(float *                     parResult,
         else
             outputFileName.insert(outputFileName.find_last_of("."), "_par2");
 
-        file_id = H5Fcreate(outputFileName.c_str(),
-                            H5F_ACC_TRUNC,
-                            H5P_DEFAULT,
-                            H5P_DEFAULT);
-        if (file_id < 0)
-            throw(ios::failure("Cannot create output file"));
+        if (extParameters.rawOutput)
+        {
+            outputFileName.replace(outputFileName.find_last_of("."), string::npos, ".raw");
+            CreateRawStream(rawStream, outputFileName, materialProperties.edgeSize);
+        }
+        else
+        {
+            file_id = H5Fcreate(outputFileName.c_str(),
+                                H5F_ACC_TRUNC,
+                                H5P_DEFAULT,
+                                H5P_DEFAULT);
+            if (file_id < 0)
+                throw(ios::failure("Cannot create output file"));
+        }
     }
+    const bool fileOutput = (file_id != H5I_INVALID_HID) || (rawStream.fd >= 0);
 
-    // we need a temporary array to prevent mixing of data form step t and t+1
+    // Parallel writer: snapshot data bypass the library and go directly into the file
+    const bool parallelWriter = (extParameters.nWriterThreads > 1) && !extParameters.IsReducedOutput();
+    int        fileDescriptor = -1;
+    if (fileOutput && parallelWriter)
+        fileDescriptor = (rawStream.fd >= 0) ? rawStream.fd : GetFileDescriptor(file_id);
+
+    // Three fields rotate between t, t+1 and the writer. A finished field is
+    // handed to the writer as it is and the computation continues with the
+    // other two, so no copy is needed.
     float * tempArray = (float *) _mm_malloc(materialProperties.nGridPoints * sizeof(float),
                                              DATA_ALIGNMENT);
-    float * buffer  = (float *) _mm_malloc(materialProperties.nGridPoints*sizeof(float), DATA_ALIGNMENT);
-    bool bufferFreeFlag = false;
-    bool writeFinishedFlag = false;
+    float * buffer    = (float *) _mm_malloc(materialProperties.nGridPoints * sizeof(float),
+                                             DATA_ALIGNMENT);
+    // Regions, overview and probes gathered for a reduced snapshot
+    float * reducedData = (float *) _mm_malloc(GetReducedSnapshotSize(extParameters, materialProperties.edgeSize) *
+                                               sizeof(float), DATA_ALIGNMENT);
+
+    // Size of one snapshot and data written so far (live metrics)
+    const size_t snapshotSize = (extParameters.IsReducedOutput()
+                                 ? GetReducedSnapshotSize(extParameters, materialProperties.edgeSize)
+                                 : materialProperties.nGridPoints) * sizeof(float);
+    size_t bytesWritten = 0;
 
     // t+1 values
     float * newTemp = parResult;
@@ -491,6 +1051,7 @@ void ParallelHeatDistributionOverlapped(float *                     parResult,
 
     //---------------------- prest the stop watch ------------------------------//
     double elapsedTime = omp_get_wtime();
+    StartMetrics(metricsPublisher, "par2", parameters.nIterations);
     size_t i, j;
     size_t iteration, printCounter = 1;
     float middleColAvgTemp = 0.0f;
@@ -500,9 +1061,11 @@ void ParallelHeatDistributionOverlapped(float *                     parResult,
     //--------------------------------------------------------------------------//
     omp_set_nested(1);
     bool finished = false;
-    bufferFreeFlag = false;
-    writeFinishedFlag = true;
-    size_t globalIteration = 0;
+    // data held by the writer (NULL = the writer is idle) and their iteration
+    float * writerBuffer = NULL;
+    size_t  writerIteration = 0;
+    // t field before the last rotation, the other versions return this one
+    float * previousTemp = tempArray;
 
     /************* Initialization *********************/
     #pragma omp parallel for
@@ -513,54 +1076,87 @@ void ParallelHeatDistributionOverlapped(float *                     parResult,
         buffer[i] = materialProperties.initTemp[i];
     }
 
-    #pragma omp parallel shared(bufferFreeFlag, writeFinishedFlag) firstprivate(printCounter) num_threads(2)
+    #pragma omp parallel shared(writerBuffer, writerIteration, finished, bytesWritten) firstprivate(printCounter) num_threads(2)
     {
         #pragma omp sections
         {
             /***************** Writing *****************/
             #pragma omp section
             {
-                bool tempBufferFreeFlag;
-                bool tempFinished;
-                size_t localIteration = 0;
+                bool    tempFinished;
+                float * tempWriterBuffer;
+                size_t  localIteration = 0;
                 while(1)
                 {
-                    #pragma omp flush(bufferFreeFlag)
+                    // read the finish flag first, the last snapshot is handed over before it is set
+                    #pragma omp flush
+                    #pragma omp atomic read
+                    tempFinished = finished;
+
+                    #pragma omp flush
                     #pragma omp atomic read
-                    tempBufferFreeFlag = bufferFreeFlag;
-                    if(tempBufferFreeFlag)
+                    tempWriterBuffer = writerBuffer;
+
+                    if (tempWriterBuffer != NULL)
                     {
-                        #pragma omp flush(globalIteration)
                         #pragma omp atomic read
-                        //#pragma omp flush(globalIteration)
-                        localIteration = globalIteration;
+                        localIteration = writerIteration;
+                        #pragma omp flush
 
-                        StoreDataIntoFile(file_id,
-                                              buffer,
+                        if (extParameters.IsReducedOutput())
+                        {
+                            StoreReducedDataIntoFile(file_id,
+                                                     tempWriterBuffer,
+                                                     extParameters,
+                                                     materialProperties.edgeSize,
+                                                     localIteration / parameters.diskWriteIntensity,
+                                                     localIteration);
+                        }
+                        else if (parallelWriter)
+                        {
+                            // nested team of writers, each thread stores one band of rows
+                            const haddr_t snapshotOffset = (rawStream.fd >= 0)
+                                    ? ReserveRawSnapshot(rawStream, localIteration)
+                                    : CreateDirectSnapshot(file_id,
+                                                           materialProperties.edgeSize,
+                                                           localIteration / parameters.diskWriteIntensity,
+                                                           localIteration);
+
+                            #pragma omp parallel num_threads(extParameters.nWriterThreads)
+                            {
+                                StoreRowsIntoFile(fileDescriptor,
+                                                  snapshotOffset,
+                                                  tempWriterBuffer,
+                                                  materialProperties.edgeSize,
+                                                  omp_get_thread_num(), omp_get_num_threads());
+                            }
+                        }
+                        else if (rawStream.fd >= 0)
+                        {
+                            StoreDataIntoRawStream(rawStream, tempWriterBuffer, localIteration);
+                        }
+                        else
+                        {
+                            StoreDataIntoFile(file_id,
+                                              tempWriterBuffer,
                                               materialProperties.edgeSize,
                                               localIteration / parameters.diskWriteIntensity,
                                               localIteration);
+                        }
 
-                        #pragma omp flush(bufferFreeFlag)
-                        #pragma omp atomic write
-                        bufferFreeFlag = false;
-                        //#pragma omp flush(bufferFreeFlag)
+                        #pragma omp atomic update
+                        bytesWritten += snapshotSize;
 
-                        #pragma omp flush(writeFinishedFlag)
+                        // give the data back to the computation
+                        #pragma omp flush
                         #pragma omp atomic write
-                        writeFinishedFlag = true;
-                        //#pragma omp flush(writeFinishedFlag)
+                        writerBuffer = NULL;
+                        #pragma omp flush
                     }
-                    #pragma omp flush(bufferFreeFlag, writeFinishedFlag, bufferFreeFlag,globalIteration) //todo
-
-                    #pragma omp flush(finished)
-                    #pragma omp atomic read
-                    tempFinished = finished;
-                    if(finished)
+                    else if (tempFinished)
                     {
                         break;
                     }
-                    #pragma omp flush(finished)
                 }
             }
 
@@ -640,52 +1236,62 @@ void ParallelHeatDistributionOverlapped(float *                     parResult,
                             middleColAvgTemp /= materialProperties.edgeSize;
                         }
 
-                        if ((file_id != H5I_INVALID_HID) && ((iteration % parameters.diskWriteIntensity) == 0))
+                        if (fileOutput && ((iteration % parameters.diskWriteIntensity) == 0))
                         {
-                            bool tempWriteFinishedFlag;
-                            while (1)
+                            // only one snapshot is in flight, wait until the writer returns the previous one
+                            #pragma omp master
                             {
+                                float * tempWriterBuffer;
+                                do
+                                {
+                                    #pragma omp flush
+                                    #pragma omp atomic read
+                                    tempWriterBuffer = writerBuffer;
+                                } while (tempWriterBuffer != NULL);
+                            }
 
-                                #pragma omp flush(writeFinishedFlag)
-                                #pragma omp atomic read
-                                tempWriteFinishedFlag = writeFinishedFlag;
+                            if (extParameters.IsReducedOutput())
+                            {
+                                #pragma omp barrier
 
-                                if (tempWriteFinishedFlag)
+                                // only the regions, overview and probes go to the writer
+                                #pragma omp for firstprivate(newTemp)
+                                for (size_t row = 0; row < materialProperties.edgeSize; row++)
                                 {
-                                    #pragma omp for firstprivate(buffer)
-                                    for (int ii = 0; ii < materialProperties.nGridPoints; ii++)
-                                    {
-                                        buffer[ii] = newTemp[ii];
-                                    }
-
-                                    #pragma omp master
-                                    {
-                                        #pragma omp flush(globalIteration)
-                                        #pragma omp atomic write
-                                        globalIteration = iteration;
-                                        //#pragma omp flush(globalIteration)
-
-                                        #pragma omp flush(writeFinishedFlag)
-                                        #pragma omp atomic write
-                                        writeFinishedFlag = false;
-                                        //#pragma omp flush(writeFinishedFlag)
-
-                                        #pragma omp flush(bufferFreeFlag)
-                                        #pragma omp atomic write
-                                        bufferFreeFlag = true;
-                                        //#pragma omp flush(bufferFreeFlag)
-                                    }
-                                    break;
+                                    ExtractReducedRow(newTemp, reducedData, extParameters,
+                                                      materialProperties.edgeSize, row);
                                 }
-                                #pragma omp flush(writeFinishedFlag, writeFinishedFlag, bufferFreeFlag, globalIteration)
+                            }
+
+                            #pragma omp master
+                            {
+                                #pragma omp atomic write
+                                writerIteration = iteration;
+
+                                #pragma omp flush
+                                #pragma omp atomic write
+                                writerBuffer = (extParameters.IsReducedOutput()) ? reducedData : newTemp;
+                                #pragma omp flush
                             }
                         }
 
 
                         #pragma omp master
                         {
-                            // swap new and old values
-                            swap(newTemp, oldTemp);
+                            // the finished field becomes t, t+1 goes to a field the writer does not hold
+                            float * tempWriterBuffer;
+                            #pragma omp flush
+                            #pragma omp atomic read
+                            tempWriterBuffer = writerBuffer;
+
+                            float * spareTemp = (parResult != newTemp && parResult != oldTemp)
+                                                ? parResult
+                                                : ((tempArray != newTemp && tempArray != oldTemp) ? tempArray : buffer);
+
+                            float * nextTemp = (oldTemp == tempWriterBuffer) ? spareTemp : oldTemp;
+                            previousTemp = oldTemp;
+                            oldTemp = newTemp;
+                            newTemp = nextTemp;
 
                             //printf("SECTION1: %zu\n", iteration);
                             if (((float) (iteration) >= (parameters.nIterations - 1) / 10.0f * (float) printCounter)
@@ -695,15 +1301,22 @@ void ParallelHeatDistributionOverlapped(float *                     parResult,
                                        middleColAvgTemp);
                                 ++printCounter;
                             }
+
+                            // publish live metrics, a held buffer is a snapshot in the I/O queue
+                            size_t tempBytesWritten;
+                            #pragma omp atomic read
+                            tempBytesWritten = bytesWritten;
+                            PublishMetrics(metricsPublisher, iteration + 1, middleColAvgTemp,
+                                           (tempWriterBuffer != NULL) ? 1 : 0, tempBytesWritten);
                         }
                         #pragma omp barrier
                     }// for iteration
                 }//omp parallel
 
-                #pragma omp flush(finished)
+                #pragma omp flush
                 #pragma omp atomic write
                 finished = true;
-                #pragma omp flush(finished)
+                #pragma omp flush
             }//calculation
         }
     } // pragma parallel
@@ -715,10 +1328,11 @@ void ParallelHeatDistributionOverlapped(float *                     parResult,
     //--------------------------------------------------------------------------//
 
     double totalTime = omp_get_wtime() - elapsedTime;
+    StopMetrics(metricsPublisher);
 
     if (!parameters.batchMode)
         printf("\nExecution time of parallel (overlapped) version: %.5fs\n", totalTime);
-    else
+    else if (!extParameters.quiet)
         printf("%s;%s;%f;%e;%e\n", outputFileName.c_str(), "par2",
                middleColAvgTemp, totalTime,
                totalTime / parameters.nIterations);
@@ -727,14 +1341,17 @@ void ParallelHeatDistributionOverlapped(float *                     parResult,
 
     // Close the output file
     if (file_id != H5I_INVALID_HID) H5Fclose(file_id);
+    if (rawStream.fd >= 0) CloseRawStream(rawStream);
 
     // return correct results in the correct array
-    if (parameters.nIterations & 1)
+    if (previousTemp != parResult)
     {
-        memcpy(parResult, tempArray, materialProperties.nGridPoints * sizeof(float));
+        memcpy(parResult, previousTemp, materialProperties.nGridPoints * sizeof(float));
     }
 
     _mm_free(tempArray);
+    _mm_free(buffer);
+    _mm_free(reducedData);
 }// end of ParallelHeatDistribution
 //------------------------------------------------------------------------------
 
@@ -806,98 +1423,1640 @@ void StoreDataIntoFile(hid_t         h5fileId,
 //------------------------------------------------------------------------------
 
 
+/**
+ * Create a new snapshot (group, dataset and attribute in Pixie format) whose
+ * data are not written by the library. The dataset is contiguous and its
+ * storage is allocated immediately, so the threads may write disjoint bands
+ * of rows directly into the file at the returned offset.
+ * @param [in] h5fileID   - handle to the output file
+ * @param [in] edgeSize   - size of the domain
+ * @param [in] snapshotId - snapshot id
+ * @param [in] iteration  - id of iteration
+ * @return position of the dataset data in the file
+ */
+haddr_t CreateDirectSnapshot(hid_t        h5fileId,
+                             const size_t edgeSize,
+                             const size_t snapshotId,
+                             const size_t iteration)
+{
+    hid_t    dataset_id, dataspace_id, group_id, attribute_id, plist_id;
+    hsize_t  dims[2] = {edgeSize, edgeSize};
+
+    string groupName = "Timestep_" + to_string((unsigned long long) snapshotId);
+
+    // Create a group named "/Timestep_snapshotId" in the file.
+    group_id = H5Gcreate(h5fileId,
+                         groupName.c_str(),
+                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+
+    // Create the data space. (2D matrix)
+    dataspace_id = H5Screate_simple(2, dims, NULL);
+
+    // Allocate the space right now and never write fill values over our data
+    plist_id = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_layout(plist_id, H5D_CONTIGUOUS);
+    H5Pset_alloc_time(plist_id, H5D_ALLOC_TIME_EARLY);
+    H5Pset_fill_time(plist_id, H5D_FILL_TIME_NEVER);
+
+    // create a dataset for temperature
+    string datasetName = "Temperature";
+    dataset_id = H5Dcreate(group_id,
+                           datasetName.c_str(),
+                           H5T_NATIVE_FLOAT,
+                           dataspace_id,
+                           H5P_DEFAULT, plist_id, H5P_DEFAULT);
+
+    const haddr_t dataOffset = H5Dget_offset(dataset_id);
+
+    H5Pclose(plist_id);
+    H5Sclose(dataspace_id);
+
+
+    // write attribute
+    string atributeName="Time";
+    dataspace_id = H5Screate(H5S_SCALAR);
+    attribute_id = H5Acreate2 (group_id, atributeName.c_str(),
+                               H5T_IEEE_F64LE, dataspace_id,
+                               H5P_DEFAULT, H5P_DEFAULT);
+
+    double snapshotTime = double(iteration);
+    H5Awrite(attribute_id, H5T_IEEE_F64LE, &snapshotTime);
+    H5Aclose(attribute_id);
+
+    // Close the dataspace, the dataset and the group
+    H5Sclose(dataspace_id);
+    H5Dclose(dataset_id);
+    H5Gclose(group_id);
+
+    if (dataOffset == HADDR_UNDEF)
+    {
+        fprintf(stderr, "[ERROR]: Cannot allocate the snapshot in the output file.\n");
+        exit(EXIT_FAILURE);
+    }
 
+    return dataOffset;
+}// end of CreateDirectSnapshot
+//------------------------------------------------------------------------------
 
 
 /**
- * Main function of the project
- * @param [in] argc
- * @param [in] argv
- * @return
+ * Write one band of rows of the snapshot directly into the output file.
+ * Rows are split evenly among the bands, the bands do not overlap.
+ * @param [in] fileDescriptor - descriptor of the output file
+ * @param [in] dataOffset     - position of the dataset in the file
+ * @param [in] data           - data to write (whole domain)
+ * @param [in] edgeSize       - size of the domain
+ * @param [in] bandId         - id of the band to write
+ * @param [in] nBands         - number of bands
  */
-int main(int argc, char *argv[])
+void StoreRowsIntoFile(int           fileDescriptor,
+                       haddr_t       dataOffset,
+                       const float * data,
+                       const size_t  edgeSize,
+                       const size_t  bandId,
+                       const size_t  nBands)
 {
+    const size_t firstRow = (edgeSize * bandId) / nBands;
+    const size_t lastRow  = (edgeSize * (bandId + 1)) / nBands;
 
-    ParseCommandline(argc, argv, parameters);
+    const char * bandData  = (const char *) (data + firstRow * edgeSize);
+    size_t       bandSize  = (lastRow - firstRow) * edgeSize * sizeof(float);
+    off_t        bandStart = dataOffset + firstRow * edgeSize * sizeof(float);
 
-    // Create material properties and load from file
-    TMaterialProperties materialProperties;
-    try
-    {
-        materialProperties.LoadMaterialData(parameters.materialFileName);
-    }
-    catch (const std::ios::failure& e) // Error while processing HDF5 file
+    // pwrite may store only a part of the band
+    while (bandSize > 0)
     {
-        fprintf(stderr, "[ERROR]: Error while processing the HDF5 file.\n");
-        exit(EXIT_FAILURE);
+        const ssize_t written = pwrite(fileDescriptor, bandData, bandSize, bandStart);
+        if (written < 0)
+        {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "[ERROR]: Cannot write the snapshot into the output file.\n");
+            exit(EXIT_FAILURE);
+        }
+        bandData  += written;
+        bandSize  -= written;
+        bandStart += written;
     }
-    catch (const std::bad_alloc& e) // Error in allocation of material properties
+}// end of StoreRowsIntoFile
+//------------------------------------------------------------------------------
+
+
+/**
+ * Get the file descriptor of an open hdf5 file (sec2 driver)
+ * @param [in] h5fileID - handle to the output file
+ * @return file descriptor
+ */
+int GetFileDescriptor(hid_t h5fileId)
+{
+    int * fileHandle = NULL;
+
+    if ((H5Fget_vfd_handle(h5fileId, H5P_DEFAULT, (void **) &fileHandle) < 0) || (fileHandle == NULL))
+        throw(ios::failure("Cannot get the descriptor of the output file"));
+
+    return *fileHandle;
+}// end of GetFileDescriptor
+//------------------------------------------------------------------------------
+
+
+/**
+ * Number of values stored in one reduced snapshot: all the regions of
+ * interest one after another, the decimated overview and the probes.
+ * @param [in] extParameters - extended parameters of the simulation
+ * @param [in] edgeSize      - size of the domain
+ * @return number of floats
+ */
+size_t GetReducedSnapshotSize(const TExtendedParameters & extParameters,
+                              const size_t                edgeSize)
+{
+    size_t reducedSize = 0;
+
+    for (size_t r = 0; r < extParameters.regions.size(); r++)
+        reducedSize += extParameters.regions[r].width * extParameters.regions[r].height;
+
+    if (extParameters.decimation > 0)
     {
-        fprintf(stderr, "[ERROR]: Bad allocation of material properties.\n");
-        exit(EXIT_FAILURE);
+        const size_t overviewSize = (edgeSize + extParameters.decimation - 1) / extParameters.decimation;
+        reducedSize += overviewSize * overviewSize;
     }
 
-    parameters.edgeSize = materialProperties.edgeSize;
+    return reducedSize + extParameters.probes.size();
+}// end of GetReducedSnapshotSize
+//------------------------------------------------------------------------------
 
-    parameters.PrintParameters();
 
-    // Memory allocation for output matrices.
-    seqResult = (float*) _mm_malloc(materialProperties.nGridPoints * sizeof(float),
-                                    DATA_ALIGNMENT);
-    parResult = (float*) _mm_malloc(materialProperties.nGridPoints * sizeof(float),
-                                    DATA_ALIGNMENT);
+/**
+ * Copy the parts of one row of the domain needed by the reduced snapshot.
+ * Every row is processed independently, so the rows may be split among
+ * threads.
+ * @param [in]  data          - whole domain
+ * @param [out] reducedData   - reduced snapshot
+ * @param [in]  extParameters - extended parameters of the simulation
+ * @param [in]  edgeSize      - size of the domain
+ * @param [in]  row           - row to process
+ */
+void ExtractReducedRow(const float *               data,
+                       float *                     reducedData,
+                       const TExtendedParameters & extParameters,
+                       const size_t                edgeSize,
+                       const size_t                row)
+{
+    const float * rowData = data + row * edgeSize;
+    size_t        offset  = 0;
 
-    // first touch for seq version
-    for (size_t i = 0; i < materialProperties.nGridPoints; i++)
+    // regions of interest
+    for (size_t r = 0; r < extParameters.regions.size(); r++)
     {
-        seqResult[i] = 0.0f;
+        const TRegion & region = extParameters.regions[r];
+
+        if ((row >= region.y) && (row < region.y + region.height))
+        {
+            memcpy(reducedData + offset + (row - region.y) * region.width,
+                   rowData + region.x,
+                   region.width * sizeof(float));
+        }
+        offset += region.width * region.height;
     }
 
-    // first touch policy
-#pragma omp parallel for
-    for (size_t i = 0; i < materialProperties.nGridPoints; i++)
+    // every n-th point of every n-th row
+    if (extParameters.decimation > 0)
     {
-        parResult[i] = 0.0f;
+        const size_t decimation   = extParameters.decimation;
+        const size_t overviewSize = (edgeSize + decimation - 1) / decimation;
+
+        if ((row % decimation) == 0)
+        {
+            float * overviewRow = reducedData + offset + (row / decimation) * overviewSize;
+            for (size_t j = 0; j < overviewSize; j++)
+                overviewRow[j] = rowData[j * decimation];
+        }
+        offset += overviewSize * overviewSize;
     }
 
-    // run sequential version if needed
-    if (parameters.IsRunSequntial())
+    // probes
+    for (size_t p = 0; p < extParameters.probes.size(); p++)
     {
-        SequentialHeatDistribution(seqResult,
-                                   materialProperties,
-                                   parameters,
-                                   parameters.outputFileName);
+        if (extParameters.probes[p].y == row)
+            reducedData[offset + p] = rowData[extParameters.probes[p].x];
     }
-    if (parameters.IsRunParallelNonOverlapped())
+}// end of ExtractReducedRow
+//------------------------------------------------------------------------------
+
+
+/**
+ * Store reduced time step into output file. The group of the snapshot holds
+ * datasets Region_<n> for the regions of interest, Overview for the
+ * decimated domain and Probes (compact 1D dataset) for the probe points.
+ * Positions are stored as attributes of the datasets.
+ * @param [in] h5fileID      - handle to the output file
+ * @param [in] reducedData   - reduced snapshot
+ * @param [in] extParameters - extended parameters of the simulation
+ * @param [in] edgeSize      - size of the domain
+ * @param [in] snapshotId    - snapshot id
+ * @param [in] iteration     - id of iteration
+ */
+void StoreReducedDataIntoFile(hid_t                       h5fileId,
+                              const float *               reducedData,
+                              const TExtendedParameters & extParameters,
+                              const size_t                edgeSize,
+                              const size_t                snapshotId,
+                              const size_t                iteration)
+{
+    hid_t  dataset_id, dataspace_id, group_id, attribute_id;
+    size_t offset = 0;
+
+    string groupName = "Timestep_" + to_string((unsigned long long) snapshotId);
+
+    // Create a group named "/Timestep_snapshotId" in the file.
+    group_id = H5Gcreate(h5fileId,
+                         groupName.c_str(),
+                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+
+    // regions of interest
+    for (size_t r = 0; r < extParameters.regions.size(); r++)
     {
-        // run the parallel version with non-overlapped file output
-        ParallelHeatDistributionNonOverlapped(parResult,
-                                              materialProperties,
-                                              parameters,
-                                              parameters.outputFileName);
+        const TRegion &          region       = extParameters.regions[r];
+        const hsize_t            dims[2]      = {region.height, region.width};
+        const hsize_t            posDims[1]   = {2};
+        const unsigned long long position[2]  = {region.x, region.y};
+
+        dataset_id = CreateAndWriteDataset(group_id,
+                                           "Region_" + to_string((unsigned long long) r),
+                                           reducedData + offset, 2, dims, H5D_CONTIGUOUS);
+        WritePositionAttribute(dataset_id, "Position", position, 1, posDims);
+        H5Dclose(dataset_id);
+
+        offset += region.width * region.height;
     }
-    if (parameters.IsRunParallelOverlapped())
+
+    // decimated domain
+    if (extParameters.decimation > 0)
     {
-        // run the parallel version with non-overlapped file output
-        ParallelHeatDistributionOverlapped(parResult,
-                                           materialProperties,
-                                           parameters,
-                                           parameters.outputFileName);
+        const size_t             overviewSize   = (edgeSize + extParameters.decimation - 1) / extParameters.decimation;
+        const hsize_t            dims[2]        = {overviewSize, overviewSize};
+        const hsize_t            decDims[1]     = {1};
+        const unsigned long long decimation[1]  = {extParameters.decimation};
+
+        dataset_id = CreateAndWriteDataset(group_id, "Overview",
+                                           reducedData + offset, 2, dims, H5D_CONTIGUOUS);
+        WritePositionAttribute(dataset_id, "Decimation", decimation, 1, decDims);
+        H5Dclose(dataset_id);
+
+        offset += overviewSize * overviewSize;
     }
 
-    // Validate the outputs
-    if (parameters.IsValidation())
+    // probes, a few values only, so keep them in the object header
+    if (!extParameters.probes.empty())
     {
-        if (parameters.debugFlag)
+        const hsize_t              dims[1]    = {extParameters.probes.size()};
+        const hsize_t              posDims[2] = {extParameters.probes.size(), 2};
+        vector<unsigned long long> positions;
+
+        for (size_t p = 0; p < extParameters.probes.size(); p++)
+        {
+            positions.push_back(extParameters.probes[p].x);
+            positions.push_back(extParameters.probes[p].y);
+        }
+
+        dataset_id = CreateAndWriteDataset(group_id, "Probes",
+                                           reducedData + offset, 1, dims, H5D_COMPACT);
+        WritePositionAttribute(dataset_id, "Positions", positions.data(), 2, posDims);
+        H5Dclose(dataset_id);
+    }
+
+    // write attribute
+    string atributeName="Time";
+    dataspace_id = H5Screate(H5S_SCALAR);
+    attribute_id = H5Acreate2 (group_id, atributeName.c_str(),
+                               H5T_IEEE_F64LE, dataspace_id,
+                               H5P_DEFAULT, H5P_DEFAULT);
+
+    double snapshotTime = double(iteration);
+    H5Awrite(attribute_id, H5T_IEEE_F64LE, &snapshotTime);
+    H5Aclose(attribute_id);
+
+    // Close the dataspace and the group
+    H5Sclose(dataspace_id);
+    H5Gclose(group_id);
+}// end of StoreReducedDataIntoFile
+//------------------------------------------------------------------------------
+
+
+/**
+ * Create a float dataset in the group and write the data into it
+ * @param [in] groupId     - handle to the group
+ * @param [in] datasetName - name of the dataset
+ * @param [in] data        - data to write
+ * @param [in] rank        - number of dimensions
+ * @param [in] dims        - dimensions
+ * @param [in] layout      - layout of the dataset (contiguous or compact)
+ * @return handle to the open dataset
+ */
+hid_t CreateAndWriteDataset(hid_t           groupId,
+                            const string &  datasetName,
+                            const float *   data,
+                            const int       rank,
+                            const hsize_t * dims,
+                            H5D_layout_t    layout)
+{
+    hid_t dataspace_id = H5Screate_simple(rank, dims, NULL);
+    hid_t plist_id     = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_layout(plist_id, layout);
+
+    hid_t dataset_id = H5Dcreate(groupId,
+                                 datasetName.c_str(),
+                                 H5T_NATIVE_FLOAT,
+                                 dataspace_id,
+                                 H5P_DEFAULT, plist_id, H5P_DEFAULT);
+    H5Dwrite(dataset_id,
+             H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+             data);
+
+    H5Pclose(plist_id);
+    H5Sclose(dataspace_id);
+
+    return dataset_id;
+}// end of CreateAndWriteDataset
+//------------------------------------------------------------------------------
+
+
+/**
+ * Write an attribute with positions (array of unsigned integers)
+ * @param [in] objectId      - handle to the dataset or group
+ * @param [in] attributeName - name of the attribute
+ * @param [in] positions     - values to write
+ * @param [in] rank          - number of dimensions
+ * @param [in] dims          - dimensions
+ */
+void WritePositionAttribute(hid_t                      objectId,
+                            const string &             attributeName,
+                            const unsigned long long * positions,
+                            const int                  rank,
+                            const hsize_t *            dims)
+{
+    hid_t dataspace_id = H5Screate_simple(rank, dims, NULL);
+    hid_t attribute_id = H5Acreate2(objectId, attributeName.c_str(),
+                                    H5T_STD_U64LE, dataspace_id,
+                                    H5P_DEFAULT, H5P_DEFAULT);
+
+    H5Awrite(attribute_id, H5T_NATIVE_ULLONG, positions);
+
+    H5Aclose(attribute_id);
+    H5Sclose(dataspace_id);
+}// end of WritePositionAttribute
+//------------------------------------------------------------------------------
+
+
+/**
+ * Create a raw snapshot stream. The stream starts with an aligned header,
+ * snapshots follow one after another, every one aligned to RAW_ALIGNMENT,
+ * and the index of (iteration, offset) pairs with a footer is appended
+ * when the stream is closed. Any snapshot can be mapped by a reader
+ * directly.
+ * @param [out] rawStream - the stream
+ * @param [in]  fileName  - name of the file
+ * @param [in]  edgeSize  - size of the domain
+ */
+void CreateRawStream(TRawStream   & rawStream,
+                     const string & fileName,
+                     const size_t   edgeSize)
+{
+    rawStream.fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (rawStream.fd < 0)
+        throw(ios::failure("Cannot create output file"));
+
+    const size_t snapshotSize = edgeSize * edgeSize * sizeof(float);
+
+    rawStream.edgeSize       = edgeSize;
+    rawStream.snapshotStride = ((snapshotSize + RAW_ALIGNMENT - 1) / RAW_ALIGNMENT) * RAW_ALIGNMENT;
+    rawStream.endOffset      = RAW_ALIGNMENT;
+    rawStream.index.clear();
+
+    TRawHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "HEATRAW1", sizeof(header.magic));
+    header.edgeSize       = edgeSize;
+    header.alignment      = RAW_ALIGNMENT;
+    header.snapshotStride = rawStream.snapshotStride;
+
+    if (pwrite(rawStream.fd, &header, sizeof(header), 0) != sizeof(header))
+        throw(ios::failure("Cannot write into output file"));
+}// end of CreateRawStream
+//------------------------------------------------------------------------------
+
+
+/**
+ * Reserve space for the next snapshot in the raw stream, the data are
+ * written by StoreRowsIntoFile.
+ * @param [in, out] rawStream - the stream
+ * @param [in]      iteration - id of iteration
+ * @return position of the snapshot in the file
+ */
+off_t ReserveRawSnapshot(TRawStream & rawStream,
+                         const size_t iteration)
+{
+    const TRawIndexEntry entry = {iteration, (uint64_t) rawStream.endOffset};
+
+    rawStream.index.push_back(entry);
+    rawStream.endOffset += rawStream.snapshotStride;
+
+    return entry.offset;
+}// end of ReserveRawSnapshot
+//------------------------------------------------------------------------------
+
+
+/**
+ * Append time step to the raw stream (one large sequential write)
+ * @param [in, out] rawStream - the stream
+ * @param [in]      data      - data to write
+ * @param [in]      iteration - id of iteration
+ */
+void StoreDataIntoRawStream(TRawStream  & rawStream,
+                            const float * data,
+                            const size_t  iteration)
+{
+    const off_t snapshotOffset = ReserveRawSnapshot(rawStream, iteration);
+
+    StoreRowsIntoFile(rawStream.fd, snapshotOffset, data, rawStream.edgeSize, 0, 1);
+}// end of StoreDataIntoRawStream
+//------------------------------------------------------------------------------
+
+
+/**
+ * Write the index and the footer and close the raw stream
+ * @param [in, out] rawStream - the stream
+ */
+void CloseRawStream(TRawStream & rawStream)
+{
+    TRawFooter footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.indexOffset = rawStream.endOffset;
+    footer.nSnapshots  = rawStream.index.size();
+    memcpy(footer.magic, "HEATIDX1", sizeof(footer.magic));
+
+    const size_t indexSize = rawStream.index.size() * sizeof(TRawIndexEntry);
+
+    if (((indexSize > 0) &&
+         (pwrite(rawStream.fd, rawStream.index.data(), indexSize, footer.indexOffset) != (ssize_t) indexSize)) ||
+        (pwrite(rawStream.fd, &footer, sizeof(footer), footer.indexOffset + indexSize) != sizeof(footer)))
+    {
+        fprintf(stderr, "[ERROR]: Cannot write the index of the raw stream.\n");
+    }
+
+    close(rawStream.fd);
+    rawStream.fd = -1;
+}// end of CloseRawStream
+//------------------------------------------------------------------------------
+
+
+/**
+ * Map a closed raw stream into memory and check its header and footer.
+ * The header is at the beginning of the mapping, the footer at the end and
+ * the snapshots and the index at the offsets stored in the footer.
+ * @param [in]  fileName - name of the stream
+ * @param [out] fileSize - size of the mapping
+ * @return the mapping (release by munmap)
+ */
+const char * MapRawStream(const string & fileName,
+                          size_t       & fileSize)
+{
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw(ios::failure("Cannot open raw stream"));
+
+    struct stat fileStat;
+    if ((fstat(fd, &fileStat) < 0) ||
+        ((size_t) fileStat.st_size < RAW_ALIGNMENT + sizeof(TRawFooter)))
+    {
+        close(fd);
+        throw(ios::failure("Raw stream is not complete"));
+    }
+    fileSize = fileStat.st_size;
+
+    void * mapping = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        throw(ios::failure("Cannot map raw stream"));
+
+    const char *       stream = (const char *) mapping;
+    const TRawHeader * header = (const TRawHeader *) stream;
+    const TRawFooter * footer = (const TRawFooter *) (stream + fileSize - sizeof(TRawFooter));
+
+    if ((memcmp(header->magic, "HEATRAW1", sizeof(header->magic)) != 0) ||
+        (memcmp(footer->magic, "HEATIDX1", sizeof(footer->magic)) != 0) ||
+        (footer->indexOffset + footer->nSnapshots * sizeof(TRawIndexEntry) + sizeof(TRawFooter) != fileSize))
+    {
+        munmap(mapping, fileSize);
+        throw(ios::failure("Not a raw stream"));
+    }
+
+    return stream;
+}// end of MapRawStream
+//------------------------------------------------------------------------------
+
+
+/**
+ * Convert a raw stream into the hdf5 (Pixie) format, one group per snapshot
+ * as written by StoreDataIntoFile
+ * @param [in] rawFileName - name of the raw stream
+ * @param [in] h5FileName  - name of the hdf5 file
+ */
+void ConvertRawStream(const string & rawFileName,
+                      const string & h5FileName)
+{
+    size_t       fileSize;
+    const char * stream = MapRawStream(rawFileName, fileSize);
+
+    const TRawHeader *     header = (const TRawHeader *) stream;
+    const TRawFooter *     footer = (const TRawFooter *) (stream + fileSize - sizeof(TRawFooter));
+    const TRawIndexEntry * index  = (const TRawIndexEntry *) (stream + footer->indexOffset);
+
+    hid_t file_id = H5Fcreate(h5FileName.c_str(),
+                              H5F_ACC_TRUNC,
+                              H5P_DEFAULT,
+                              H5P_DEFAULT);
+    if (file_id < 0)
+    {
+        munmap((void *) stream, fileSize);
+        throw(ios::failure("Cannot create output file"));
+    }
+
+    for (size_t s = 0; s < footer->nSnapshots; s++)
+    {
+        StoreDataIntoFile(file_id,
+                          (const float *) (stream + index[s].offset),
+                          header->edgeSize,
+                          s,
+                          index[s].iteration);
+    }
+
+    H5Fclose(file_id);
+    munmap((void *) stream, fileSize);
+}// end of ConvertRawStream
+//------------------------------------------------------------------------------
+
+
+/**
+ * Compare the result with the reference. Rows are split among threads, the
+ * errors of a row are reduced in SIMD lanes and the row with the worst
+ * point is searched again only when it improves the thread maximum.
+ * @param [in] reference - reference temperature (sequential or golden)
+ * @param [in] result    - temperature to check
+ * @param [in] edgeSize  - size of the domain
+ * @return maximum errors and position of the worst point
+ */
+TVerificationReport CompareResults(const float * reference,
+                                   const float * result,
+                                   const size_t  edgeSize)
+{
+    TVerificationReport report = {0.0f, 0.0f, 0, 0, 0, 0};
+
+    #pragma omp parallel
+    {
+        TVerificationReport local = {0.0f, 0.0f, 0, 0, 0, 0};
+
+        #pragma omp for schedule(static)
+        for (size_t i = 0; i < edgeSize; i++)
+        {
+            const float * referenceRow = reference + i * edgeSize;
+            const float * resultRow    = result    + i * edgeSize;
+
+            float    rowAbsError    = 0.0f;
+            float    rowRelError    = 0.0f;
+            uint32_t rowUlpDistance = 0;
+            size_t   rowNonFinite   = 0;
+
+            // fmaxf ignores NaNs, non-finite points are counted separately
+            #pragma omp simd reduction(max:rowAbsError, rowRelError, rowUlpDistance) reduction(+:rowNonFinite)
+            for (size_t j = 0; j < edgeSize; j++)
+            {
+                const float absError = fabsf(resultRow[j] - referenceRow[j]);
+                const float relError = absError / fmaxf(fabsf(referenceRow[j]), FLT_MIN);
+
+                // map the floats onto a monotonic integer scale
+                int32_t a, b;
+                memcpy(&a, &referenceRow[j], sizeof(a));
+                memcpy(&b, &resultRow[j], sizeof(b));
+                a = (a < 0) ? int32_t(0x80000000u - uint32_t(a)) : a;
+                b = (b < 0) ? int32_t(0x80000000u - uint32_t(b)) : b;
+                const uint32_t ulpDistance = (a > b) ? uint32_t(a) - uint32_t(b) : uint32_t(b) - uint32_t(a);
+
+                rowAbsError    = fmaxf(rowAbsError, absError);
+                rowRelError    = fmaxf(rowRelError, relError);
+                rowUlpDistance = max(rowUlpDistance, ulpDistance);
+                rowNonFinite  += !(absError <= FLT_MAX);
+            }
+
+            local.nNonFinite     += rowNonFinite;
+            local.maxRelError    = max(local.maxRelError, rowRelError);
+            local.maxUlpDistance = max(local.maxUlpDistance, rowUlpDistance);
+
+            if (rowAbsError > local.maxAbsError)
+            {
+                local.maxAbsError = rowAbsError;
+                local.worstRow    = i;
+                for (size_t j = 0; j < edgeSize; j++)
+                {
+                    if (fabsf(resultRow[j] - referenceRow[j]) == rowAbsError)
+                    {
+                        local.worstCol = j;
+                        break;
+                    }
+                }
+            }
+        }
+
+        #pragma omp critical (verification)
+        {
+            report.maxRelError    = max(report.maxRelError, local.maxRelError);
+            report.maxUlpDistance = max(report.maxUlpDistance, local.maxUlpDistance);
+            report.nNonFinite    += local.nNonFinite;
+
+            if ((local.maxAbsError > report.maxAbsError) ||
+                ((local.maxAbsError == report.maxAbsError) && (local.worstRow < report.worstRow)))
+            {
+                report.maxAbsError = local.maxAbsError;
+                report.worstRow    = local.worstRow;
+                report.worstCol    = local.worstCol;
+            }
+        }
+    }
+
+    return report;
+}// end of CompareResults
+//------------------------------------------------------------------------------
+
+
+/**
+ * Print a window of (2 * PRINT_WINDOW_RADIUS + 1)^2 points around the given
+ * point, clipped by the domain
+ * @param [in] data      - domain to print
+ * @param [in] edgeSize  - size of the domain
+ * @param [in] centerRow - row of the center of the window
+ * @param [in] centerCol - column of the center of the window
+ */
+void PrintWindow(const float * data,
+                 const size_t  edgeSize,
+                 const size_t  centerRow,
+                 const size_t  centerCol)
+{
+    const size_t firstRow = (centerRow > PRINT_WINDOW_RADIUS) ? centerRow - PRINT_WINDOW_RADIUS : 0;
+    const size_t firstCol = (centerCol > PRINT_WINDOW_RADIUS) ? centerCol - PRINT_WINDOW_RADIUS : 0;
+    const size_t lastRow  = min(edgeSize, centerRow + PRINT_WINDOW_RADIUS + 1);
+    const size_t lastCol  = min(edgeSize, centerCol + PRINT_WINDOW_RADIUS + 1);
+
+    printf("rows %zu-%zu, columns %zu-%zu\n", firstRow, lastRow - 1, firstCol, lastCol - 1);
+    for (size_t i = firstRow; i < lastRow; i++)
+    {
+        for (size_t j = firstCol; j < lastCol; j++)
+            printf("%8.3f ", data[i * edgeSize + j]);
+        printf("\n");
+    }
+}// end of PrintWindow
+//------------------------------------------------------------------------------
+
+
+/**
+ * Store the final temperature as a golden file (dataset Temperature with
+ * the number of iterations as an attribute)
+ * @param [in] fileName    - name of the golden file
+ * @param [in] data        - final temperature
+ * @param [in] edgeSize    - size of the domain
+ * @param [in] nIterations - number of iterations of the simulation
+ */
+void StoreGoldenFile(const string & fileName,
+                     const float  * data,
+                     const size_t   edgeSize,
+                     const size_t   nIterations)
+{
+    hid_t file_id = H5Fcreate(fileName.c_str(),
+                              H5F_ACC_TRUNC,
+                              H5P_DEFAULT,
+                              H5P_DEFAULT);
+    if (file_id < 0)
+        throw(ios::failure("Cannot create golden file"));
+
+    const hsize_t            dims[2]        = {edgeSize, edgeSize};
+    const hsize_t            attrDims[1]    = {1};
+    const unsigned long long iterations[1]  = {nIterations};
+
+    hid_t dataset_id = CreateAndWriteDataset(file_id, "Temperature", data, 2, dims, H5D_CONTIGUOUS);
+    WritePositionAttribute(dataset_id, "Iterations", iterations, 1, attrDims);
+
+    H5Dclose(dataset_id);
+    H5Fclose(file_id);
+}// end of StoreGoldenFile
+//------------------------------------------------------------------------------
+
+
+/**
+ * Load the final temperature from a golden file, the file has to match the
+ * domain and the number of iterations
+ * @param [in]  fileName    - name of the golden file
+ * @param [out] data        - final temperature
+ * @param [in]  edgeSize    - size of the domain
+ * @param [in]  nIterations - number of iterations of the simulation
+ */
+void LoadGoldenFile(const string & fileName,
+                    float        * data,
+                    const size_t   edgeSize,
+                    const size_t   nIterations)
+{
+    hid_t file_id = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (file_id < 0)
+        throw(ios::failure("Cannot open golden file"));
+
+    hid_t   dataset_id   = H5Dopen(file_id, "Temperature", H5P_DEFAULT);
+    hid_t   dataspace_id = H5Dget_space(dataset_id);
+    hid_t   attribute_id = H5Aopen(dataset_id, "Iterations", H5P_DEFAULT);
+    hsize_t dims[2]      = {0, 0};
+    unsigned long long iterations = 0;
+
+    const bool valid = (dataset_id >= 0) && (attribute_id >= 0) &&
+                       (H5Sget_simple_extent_ndims(dataspace_id) == 2) &&
+                       (H5Sget_simple_extent_dims(dataspace_id, dims, NULL) == 2) &&
+                       (dims[0] == edgeSize) && (dims[1] == edgeSize) &&
+                       (H5Aread(attribute_id, H5T_NATIVE_ULLONG, &iterations) >= 0) &&
+                       (iterations == nIterations) &&
+                       (H5Dread(dataset_id, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data) >= 0);
+
+    if (attribute_id >= 0) H5Aclose(attribute_id);
+    if (dataspace_id >= 0) H5Sclose(dataspace_id);
+    if (dataset_id   >= 0) H5Dclose(dataset_id);
+    H5Fclose(file_id);
+
+    if (!valid)
+        throw(ios::failure("Golden file does not match the simulation"));
+}// end of LoadGoldenFile
+//------------------------------------------------------------------------------
+
+
+/**
+ * Run short calibration sweeps and find the fastest configuration of the
+ * parallel simulation for the domain. The sweep is done in stages, every
+ * stage keeps the best values of the previous ones:
+ *   [1] number of threads x non-overlapped / overlapped version
+ *   [2] number of writer threads (single H5Dwrite writer or parallel bands)
+ *   [3] disk write intensity - the densest output not slower than the best
+ *       one by more than AUTOTUNE_TOLERANCE
+ * Stages 2 and 3 are skipped without file output.
+ * @param [in] materialProperties - Material properties
+ * @param [in] parameters         - parameters of the simulation
+ * @return the fastest configuration
+ */
+TTunedConfiguration AutotuneConfiguration(const TMaterialProperties & materialProperties,
+                                          const TParameters         & parameters)
+{
+    const bool fileOutput = (parameters.outputFileName != "");
+
+    // calibration snapshots go next to the real output
+    string calibrationFileName = parameters.outputFileName;
+    if (fileOutput)
+    {
+        if (calibrationFileName.find(".h5") == string::npos)
+            calibrationFileName.append("_autotune.h5");
+        else
+            calibrationFileName.insert(calibrationFileName.find_last_of("."), "_autotune");
+    }
+
+    TTunedConfiguration best;
+    best.edgeSize           = materialProperties.edgeSize;
+    best.fileOutput         = fileOutput;
+    best.overlapped         = false;
+    best.nThreads           = 1;
+    best.diskWriteIntensity = parameters.diskWriteIntensity;
+    best.nWriterThreads     = 1;
+    best.iterationTime      = 0.0;
+
+    if (!parameters.batchMode)
+        printf("Autotuning the parallel simulation (%d iterations per run) ... \n", AUTOTUNE_ITERATIONS);
+
+    // [1] threads and version of the simulation, powers of two and all cores
+    vector<size_t> threadCounts;
+    for (size_t nThreads = 1; nThreads < (size_t) omp_get_num_procs(); nThreads *= 2)
+        threadCounts.push_back(nThreads);
+    threadCounts.push_back(omp_get_num_procs());
+
+    for (size_t t = 0; t < threadCounts.size(); t++)
+    {
+        for (int overlapped = 0; overlapped <= 1; overlapped++)
+        {
+            // the overlapped version needs one writer and at least one computing thread
+            if (overlapped && (!fileOutput || (threadCounts[t] < 2)))
+                continue;
+
+            TTunedConfiguration candidate = best;
+            candidate.nThreads   = threadCounts[t];
+            candidate.overlapped = overlapped;
+            candidate.iterationTime = MeasureConfiguration(materialProperties, parameters,
+                                                           candidate, calibrationFileName);
+
+            if ((best.iterationTime == 0.0) || (candidate.iterationTime < best.iterationTime))
+                best = candidate;
+        }
+    }
+
+    if (fileOutput)
+    {
+        // [2] writer threads
+        const size_t writerCounts[] = {2, 4, 8};
+        for (size_t w = 0; w < sizeof(writerCounts) / sizeof(writerCounts[0]); w++)
+        {
+            if (writerCounts[w] > best.nThreads)
+                break;
+
+            TTunedConfiguration candidate = best;
+            candidate.nWriterThreads = writerCounts[w];
+            candidate.iterationTime  = MeasureConfiguration(materialProperties, parameters,
+                                                            candidate, calibrationFileName);
+
+            if (candidate.iterationTime < best.iterationTime)
+                best = candidate;
+        }
+
+        // [3] disk write intensity, from the densest output
+        const size_t intensities[] = {1, 2, 3, 4, 5, 10, 20, 50};
+        const size_t nIntensities  = sizeof(intensities) / sizeof(intensities[0]);
+        vector<double> times(nIntensities, 0.0);
+        double         fastest = best.iterationTime;
+
+        for (size_t w = 0; w < nIntensities; w++)
+        {
+            TTunedConfiguration candidate = best;
+            candidate.diskWriteIntensity = intensities[w];
+            times[w] = MeasureConfiguration(materialProperties, parameters,
+                                            candidate, calibrationFileName);
+            fastest  = min(fastest, times[w]);
+        }
+
+        for (size_t w = 0; w < nIntensities; w++)
+        {
+            if (times[w] <= fastest * AUTOTUNE_TOLERANCE)
+            {
+                best.diskWriteIntensity = intensities[w];
+                best.iterationTime      = times[w];
+                break;
+            }
+        }
+    }
+
+    return best;
+}// end of AutotuneConfiguration
+//------------------------------------------------------------------------------
+
+
+/**
+ * Measure the time of one iteration of the given configuration. The
+ * simulation runs AUTOTUNE_ITERATIONS iterations in quiet batch mode, its
+ * snapshots are removed afterwards.
+ * @param [in] materialProperties  - Material properties
+ * @param [in] parameters          - parameters of the simulation
+ * @param [in] configuration       - configuration to measure
+ * @param [in] calibrationFileName - output file of the calibration run
+ * @return time of one iteration
+ */
+double MeasureConfiguration(const TMaterialProperties & materialProperties,
+                            const TParameters         & parameters,
+                            const TTunedConfiguration & configuration,
+                            const string              & calibrationFileName)
+{
+    TParameters calibrationParameters = parameters;
+    calibrationParameters.nIterations        = min((size_t) AUTOTUNE_ITERATIONS, parameters.nIterations);
+    calibrationParameters.nThreads           = configuration.nThreads;
+    calibrationParameters.diskWriteIntensity = configuration.diskWriteIntensity;
+    calibrationParameters.batchMode          = true;
+
+    const size_t nWriterThreads = extParameters.nWriterThreads;
+    extParameters.nWriterThreads = configuration.nWriterThreads;
+    extParameters.quiet          = true;
+    omp_set_num_threads(configuration.nThreads);
+
+    float * calibrationResult = (float *) _mm_malloc(materialProperties.nGridPoints * sizeof(float),
+                                                     DATA_ALIGNMENT);
+
+    double elapsedTime = omp_get_wtime();
+    if (configuration.overlapped)
+        ParallelHeatDistributionOverlapped(calibrationResult, materialProperties,
+                                           calibrationParameters, calibrationFileName);
+    else
+        ParallelHeatDistributionNonOverlapped(calibrationResult, materialProperties,
+                                              calibrationParameters, calibrationFileName);
+    elapsedTime = omp_get_wtime() - elapsedTime;
+
+    _mm_free(calibrationResult);
+    extParameters.nWriterThreads = nWriterThreads;
+    extParameters.quiet          = false;
+
+    // remove the calibration snapshots (named as by the simulation)
+    if (calibrationFileName != "")
+    {
+        string calibrationPar = calibrationFileName;
+        calibrationPar.insert(calibrationPar.find_last_of("."), configuration.overlapped ? "_par2" : "_par1");
+        if (extParameters.rawOutput)
+            calibrationPar.replace(calibrationPar.find_last_of("."), string::npos, ".raw");
+        remove(calibrationPar.c_str());
+    }
+
+    return elapsedTime / calibrationParameters.nIterations;
+}// end of MeasureConfiguration
+//------------------------------------------------------------------------------
+
+
+/**
+ * Load the tuned configuration for the domain from the profile. The profile
+ * is a text file with one configuration per line:
+ *   edgeSize fileOutput overlapped nThreads diskWriteIntensity nWriterThreads iterationTime
+ * @param [in]  profileFileName - name of the profile
+ * @param [in]  edgeSize        - size of the domain
+ * @param [in]  fileOutput      - configuration with file output
+ * @param [out] configuration   - loaded configuration
+ * @return true if the profile contains the configuration
+ */
+bool LoadTunedConfiguration(const string        & profileFileName,
+                            const size_t          edgeSize,
+                            const bool            fileOutput,
+                            TTunedConfiguration & configuration)
+{
+    FILE * profile = fopen(profileFileName.c_str(), "r");
+    if (profile == NULL)
+        return false;
+
+    bool found = false;
+    char line[256];
+
+    while (fgets(line, sizeof(line), profile) != NULL)
+    {
+        TTunedConfiguration loaded;
+        int                 loadedFileOutput, loadedOverlapped;
+
+        if (sscanf(line, "%zu %d %d %zu %zu %zu %lf",
+                   &loaded.edgeSize, &loadedFileOutput, &loadedOverlapped,
+                   &loaded.nThreads, &loaded.diskWriteIntensity,
+                   &loaded.nWriterThreads, &loaded.iterationTime) != 7)
+            continue;
+
+        loaded.fileOutput = loadedFileOutput;
+        loaded.overlapped = loadedOverlapped;
+
+        if ((loaded.edgeSize == edgeSize) && (loaded.fileOutput == fileOutput))
+        {
+            configuration = loaded;
+            found         = true;
+        }
+    }
+
+    fclose(profile);
+    return found;
+}// end of LoadTunedConfiguration
+//------------------------------------------------------------------------------
+
+
+/**
+ * Store the tuned configuration into the profile, replacing the old
+ * configuration of the same domain.
+ * @param [in] profileFileName - name of the profile
+ * @param [in] configuration   - configuration to store
+ */
+void StoreTunedConfiguration(const string              & profileFileName,
+                             const TTunedConfiguration & configuration)
+{
+    vector<string> lines;
+    char           line[256];
+
+    // keep the configurations of other domains
+    FILE * profile = fopen(profileFileName.c_str(), "r");
+    if (profile != NULL)
+    {
+        while (fgets(line, sizeof(line), profile) != NULL)
+        {
+            size_t edgeSize;
+            int    fileOutput;
+
+            if ((line[0] == '#') ||
+                ((sscanf(line, "%zu %d", &edgeSize, &fileOutput) == 2) &&
+                 (edgeSize == configuration.edgeSize) && (bool(fileOutput) == configuration.fileOutput)))
+                continue;
+
+            lines.push_back(line);
+        }
+        fclose(profile);
+    }
+
+    profile = fopen(profileFileName.c_str(), "w");
+    if (profile == NULL)
+        throw(ios::failure("Cannot create profile file"));
+
+    fprintf(profile, "# edgeSize fileOutput overlapped nThreads diskWriteIntensity nWriterThreads iterationTime\n");
+    for (size_t l = 0; l < lines.size(); l++)
+        fputs(lines[l].c_str(), profile);
+
+    fprintf(profile, "%zu %d %d %zu %zu %zu %e\n",
+            configuration.edgeSize, int(configuration.fileOutput), int(configuration.overlapped),
+            configuration.nThreads, configuration.diskWriteIntensity,
+            configuration.nWriterThreads, configuration.iterationTime);
+
+    fclose(profile);
+}// end of StoreTunedConfiguration
+//------------------------------------------------------------------------------
+
+
+/**
+ * Name of the profile file, heat_profile_<hostname>.txt unless given by
+ * --profile
+ * @param [in] extParameters - extended parameters of the simulation
+ * @return name of the profile file
+ */
+string GetProfileFileName(const TExtendedParameters & extParameters)
+{
+    if (extParameters.profileFileName != "")
+        return extParameters.profileFileName;
+
+    char hostName[256] = "localhost";
+    gethostname(hostName, sizeof(hostName) - 1);
+
+    return string("heat_profile_") + hostName + ".txt";
+}// end of GetProfileFileName
+//------------------------------------------------------------------------------
+
+
+/**
+ * Create the metrics file and map it into memory. The file can be mapped
+ * by any number of readers (a job monitor or --read-metrics), they never
+ * block the simulation.
+ * @param [out] publisher - publisher of the metrics
+ * @param [in]  fileName  - name of the metrics file
+ */
+void CreateMetrics(TMetricsPublisher & publisher,
+                   const string      & fileName)
+{
+    const int fd = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw(ios::failure("Cannot create metrics file"));
+
+    if (ftruncate(fd, sizeof(TMetricsSegment)) < 0)
+    {
+        close(fd);
+        throw(ios::failure("Cannot create metrics file"));
+    }
+
+    void * mapping = mmap(NULL, sizeof(TMetricsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        throw(ios::failure("Cannot map metrics file"));
+
+    publisher.segment = (TMetricsSegment *) mapping;
+
+    memset(&publisher.sample, 0, sizeof(publisher.sample));
+    publisher.sample.pid   = getpid();
+    publisher.sample.state = METRICS_IDLE;
+
+    WriteMetricsSample(publisher.segment, publisher.sample);
+    memcpy(publisher.segment->magic, "HEATMET1", sizeof(publisher.segment->magic));
+}// end of CreateMetrics
+//------------------------------------------------------------------------------
+
+
+/**
+ * Publish the start of a version of the simulation
+ * @param [in, out] publisher   - publisher of the metrics
+ * @param [in]      version     - name of the version (seq, par1, par2)
+ * @param [in]      nIterations - number of iterations
+ */
+void StartMetrics(TMetricsPublisher & publisher,
+                  const char        * version,
+                  const size_t        nIterations)
+{
+    if (publisher.segment == NULL) return;
+
+    strncpy(publisher.sample.version, version, sizeof(publisher.sample.version) - 1);
+    publisher.sample.state               = METRICS_RUNNING;
+    publisher.sample.ioQueueDepth        = 0;
+    publisher.sample.iteration           = 0;
+    publisher.sample.nIterations         = nIterations;
+    publisher.sample.iterationsPerSecond = 0.0;
+    publisher.sample.middleColAvgTemp    = 0.0;
+    publisher.sample.bytesWritten        = 0;
+    publisher.startTime = omp_get_wtime();
+
+    WriteMetricsSample(publisher.segment, publisher.sample);
+}// end of StartMetrics
+//------------------------------------------------------------------------------
+
+
+/**
+ * Publish the progress of the running version. Only the thread printing
+ * the progress calls it, so there is no other writer and the update takes
+ * no lock.
+ * @param [in, out] publisher        - publisher of the metrics
+ * @param [in]      iteration        - number of finished iterations
+ * @param [in]      middleColAvgTemp - average temperature in the middle column
+ * @param [in]      ioQueueDepth     - number of snapshots waiting for the writer
+ * @param [in]      bytesWritten     - snapshot data written so far
+ */
+void PublishMetrics(TMetricsPublisher & publisher,
+                    const size_t        iteration,
+                    const float         middleColAvgTemp,
+                    const size_t        ioQueueDepth,
+                    const size_t        bytesWritten)
+{
+    if (publisher.segment == NULL) return;
+
+    const double elapsedTime = omp_get_wtime() - publisher.startTime;
+
+    publisher.sample.iteration           = iteration;
+    publisher.sample.iterationsPerSecond = (elapsedTime > 0.0) ? iteration / elapsedTime : 0.0;
+    publisher.sample.middleColAvgTemp    = middleColAvgTemp;
+    publisher.sample.ioQueueDepth        = ioQueueDepth;
+    publisher.sample.bytesWritten        = bytesWritten;
+
+    WriteMetricsSample(publisher.segment, publisher.sample);
+}// end of PublishMetrics
+//------------------------------------------------------------------------------
+
+
+/**
+ * Publish the end of the running version
+ * @param [in, out] publisher - publisher of the metrics
+ */
+void StopMetrics(TMetricsPublisher & publisher)
+{
+    if (publisher.segment == NULL) return;
+
+    publisher.sample.state        = METRICS_IDLE;
+    publisher.sample.ioQueueDepth = 0;
+
+    WriteMetricsSample(publisher.segment, publisher.sample);
+}// end of StopMetrics
+//------------------------------------------------------------------------------
+
+
+/**
+ * Publish the end of the simulation and unmap the metrics file
+ * @param [in, out] publisher - publisher of the metrics
+ */
+void CloseMetrics(TMetricsPublisher & publisher)
+{
+    if (publisher.segment == NULL) return;
+
+    publisher.sample.state = METRICS_CLOSED;
+    WriteMetricsSample(publisher.segment, publisher.sample);
+
+    munmap(publisher.segment, sizeof(TMetricsSegment));
+    publisher.segment = NULL;
+}// end of CloseMetrics
+//------------------------------------------------------------------------------
+
+
+/**
+ * Copy the sample into the metrics file under the seqlock. The sequence is
+ * odd while the sample is being copied, a reader retries when it sees an
+ * odd sequence or when the sequence changed during its read.
+ * @param [in, out] segment - mapped metrics file
+ * @param [in]      sample  - sample to publish
+ */
+void WriteMetricsSample(TMetricsSegment      * segment,
+                        const TMetricsSample & sample)
+{
+    const uint64_t sequence = __atomic_load_n(&segment->sequence, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&segment->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(&segment->sample, &sample, sizeof(sample));
+
+    __atomic_store_n(&segment->sequence, sequence + 2, __ATOMIC_RELEASE);
+}// end of WriteMetricsSample
+//------------------------------------------------------------------------------
+
+
+/**
+ * Print samples from the metrics file of a running simulation until the
+ * simulation closes the file or its process ends
+ * @param [in] fileName       - name of the metrics file
+ * @param [in] samplingPeriod - period of sampling [ms]
+ */
+void ReadMetrics(const string & fileName,
+                 const size_t   samplingPeriod)
+{
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw(ios::failure("Cannot open metrics file"));
+
+    struct stat fileStat;
+    if ((fstat(fd, &fileStat) < 0) || ((size_t) fileStat.st_size < sizeof(TMetricsSegment)))
+    {
+        close(fd);
+        throw(ios::failure("Not a metrics file"));
+    }
+
+    void * mapping = mmap(NULL, sizeof(TMetricsSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        throw(ios::failure("Cannot map metrics file"));
+
+    const TMetricsSegment * segment = (const TMetricsSegment *) mapping;
+    if (memcmp(segment->magic, "HEATMET1", sizeof(segment->magic)) != 0)
+    {
+        munmap(mapping, sizeof(TMetricsSegment));
+        throw(ios::failure("Not a metrics file"));
+    }
+
+    uint64_t lastSequence = 0;
+
+    while (true)
+    {
+        TMetricsSample sample;
+        uint64_t       sequence;
+
+        // consistent copy of the sample, the publisher is never blocked
+        while (true)
+        {
+            sequence = __atomic_load_n(&segment->sequence, __ATOMIC_ACQUIRE);
+            if (sequence & 1) continue;
+
+            memcpy(&sample, (const void *) &segment->sample, sizeof(sample));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+            if (__atomic_load_n(&segment->sequence, __ATOMIC_RELAXED) == sequence) break;
+        }
+
+        if (sequence != lastSequence)
+        {
+            printf("%-4.4s %-7s iteration %llu/%llu, %.1f it/s, average temperature %.2f, "
+                   "I/O queue %u, %llu B written\n",
+                   sample.version,
+                   (sample.state == METRICS_RUNNING) ? "running" :
+                   (sample.state == METRICS_IDLE)    ? "idle"    : "closed",
+                   (unsigned long long) sample.iteration, (unsigned long long) sample.nIterations,
+                   sample.iterationsPerSecond, sample.middleColAvgTemp,
+                   sample.ioQueueDepth, (unsigned long long) sample.bytesWritten);
+            fflush(stdout);
+            lastSequence = sequence;
+        }
+
+        if ((sample.state == METRICS_CLOSED) ||
+            ((kill(sample.pid, 0) < 0) && (errno == ESRCH)))
+            break;
+
+        usleep(samplingPeriod * 1000);
+    }
+
+    munmap(mapping, sizeof(TMetricsSegment));
+}// end of ReadMetrics
+//------------------------------------------------------------------------------
+
+
+/**
+ * Parse extended parameters (long options) and remove them from argv, so
+ * the rest can be processed by ParseCommandline
+ *   --writer-threads <n> - number of threads writing one snapshot
+ *   --roi <x,y,w,h>      - store this region of interest (may be repeated)
+ *   --decimate <n>       - store every n-th point of every n-th row
+ *   --probe <x,y>        - store the temperature in this point (may be repeated)
+ *   --autotune           - find the fastest configuration and store it into the profile
+ *   --tuned              - use the configuration from the profile
+ *   --profile <file>     - profile file (default heat_profile_<hostname>.txt)
+ *   --raw-output         - store snapshots into a raw binary stream (.raw)
+ *   --golden <file>      - verify against the golden file, skip the sequential version
+ *   --store-golden <file>- store the result of the sequential version as a golden file
+ *   --metrics <file>     - publish live metrics into the file (see --read-metrics)
+ * If any of --roi, --decimate or --probe is given, the whole domain is not
+ * stored.
+ * @param [in, out] argc
+ * @param [in, out] argv
+ * @param [out]     extParameters - extended parameters of the simulation
+ */
+void ParseExtendedCommandline(int &                 argc,
+                              char *                argv[],
+                              TExtendedParameters & extParameters)
+{
+    int nArgs = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const string option = argv[i];
+
+        if (option == "--writer-threads")
+        {
+            if ((i + 1 >= argc) || (atol(argv[i + 1]) < 1))
+            {
+                fprintf(stderr, "[ERROR]: --writer-threads requires a positive number.\n");
+                exit(EXIT_FAILURE);
+            }
+            extParameters.nWriterThreads = atol(argv[++i]);
+        }
+        else if (option == "--roi")
+        {
+            TRegion region;
+            if ((i + 1 >= argc) ||
+                (sscanf(argv[i + 1], "%zu,%zu,%zu,%zu", &region.x, &region.y,
+                        &region.width, &region.height) != 4) ||
+                (region.width == 0) || (region.height == 0))
+            {
+                fprintf(stderr, "[ERROR]: --roi requires x,y,width,height.\n");
+                exit(EXIT_FAILURE);
+            }
+            extParameters.regions.push_back(region);
+            i++;
+        }
+        else if (option == "--decimate")
+        {
+            if ((i + 1 >= argc) || (atol(argv[i + 1]) < 1))
+            {
+                fprintf(stderr, "[ERROR]: --decimate requires a positive number.\n");
+                exit(EXIT_FAILURE);
+            }
+            extParameters.decimation = atol(argv[++i]);
+        }
+        else if (option == "--probe")
+        {
+            TRegion probe = {0, 0, 1, 1};
+            if ((i + 1 >= argc) || (sscanf(argv[i + 1], "%zu,%zu", &probe.x, &probe.y) != 2))
+            {
+                fprintf(stderr, "[ERROR]: --probe requires x,y.\n");
+                exit(EXIT_FAILURE);
+            }
+            extParameters.probes.push_back(probe);
+            i++;
+        }
+        else if (option == "--autotune")
+        {
+            extParameters.autotune = true;
+        }
+        else if (option == "--tuned")
+        {
+            extParameters.tuned = true;
+        }
+        else if ((option == "--golden") || (option == "--store-golden"))
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "[ERROR]: %s requires a file name.\n", option.c_str());
+                exit(EXIT_FAILURE);
+            }
+            if (option == "--golden")
+                extParameters.goldenFileName = argv[++i];
+            else
+                extParameters.storeGoldenFileName = argv[++i];
+        }
+        else if (option == "--raw-output")
+        {
+            extParameters.rawOutput = true;
+        }
+        else if (option == "--profile")
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "[ERROR]: --profile requires a file name.\n");
+                exit(EXIT_FAILURE);
+            }
+            extParameters.profileFileName = argv[++i];
+        }
+        else if (option == "--metrics")
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "[ERROR]: --metrics requires a file name.\n");
+                exit(EXIT_FAILURE);
+            }
+            extParameters.metricsFileName = argv[++i];
+        }
+        else
+        {
+            // keep the option for ParseCommandline
+            argv[nArgs++] = argv[i];
+        }
+    }
+
+    argv[nArgs] = NULL;
+    argc = nArgs;
+
+    if (extParameters.rawOutput && extParameters.IsReducedOutput())
+    {
+        fprintf(stderr, "[ERROR]: --raw-output stores the whole domain, it cannot be used with --roi, --decimate or --probe.\n");
+        exit(EXIT_FAILURE);
+    }
+}// end of ParseExtendedCommandline
+//------------------------------------------------------------------------------
+
+
+
+
+
+/**
+ * Main function of the project
+ * @param [in] argc
+ * @param [in] argv
+ * @return
+ */
+int main(int argc, char *argv[])
+{
+
+    // Conversion of a raw stream does not run any simulation
+    if ((argc == 4) && (string(argv[1]) == "--convert-raw"))
+    {
+        try
+        {
+            ConvertRawStream(argv[2], argv[3]);
+        }
+        catch (const std::ios::failure& e)
+        {
+            fprintf(stderr, "[ERROR]: %s.\n", e.what());
+            exit(EXIT_FAILURE);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // Reader of the live metrics of another running simulation
+    if (((argc == 3) || (argc == 4)) && (string(argv[1]) == "--read-metrics"))
+    {
+        try
+        {
+            ReadMetrics(argv[2], (argc == 4) ? atol(argv[3]) : METRICS_SAMPLING_PERIOD);
+        }
+        catch (const std::ios::failure& e)
+        {
+            fprintf(stderr, "[ERROR]: Error while reading the metrics file.\n");
+            exit(EXIT_FAILURE);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    ParseExtendedCommandline(argc, argv, extParameters);
+    ParseCommandline(argc, argv, parameters);
+
+    if (extParameters.metricsFileName != "")
+    {
+        try
+        {
+            CreateMetrics(metricsPublisher, extParameters.metricsFileName);
+        }
+        catch (const std::ios::failure& e)
+        {
+            fprintf(stderr, "[ERROR]: Metrics file cannot be created.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Create material properties and load from file
+    TMaterialProperties materialProperties;
+    try
+    {
+        materialProperties.LoadMaterialData(parameters.materialFileName);
+    }
+    catch (const std::ios::failure& e) // Error while processing HDF5 file
+    {
+        fprintf(stderr, "[ERROR]: Error while processing the HDF5 file.\n");
+        exit(EXIT_FAILURE);
+    }
+    catch (const std::bad_alloc& e) // Error in allocation of material properties
+    {
+        fprintf(stderr, "[ERROR]: Bad allocation of material properties.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    parameters.edgeSize = materialProperties.edgeSize;
+
+    if (!extParameters.FitsDomain(materialProperties.edgeSize))
+    {
+        fprintf(stderr, "[ERROR]: Region of interest or probe does not fit into the domain.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    parameters.PrintParameters();
+
+    // Memory allocation for output matrices.
+    seqResult = (float*) _mm_malloc(materialProperties.nGridPoints * sizeof(float),
+                                    DATA_ALIGNMENT);
+    parResult = (float*) _mm_malloc(materialProperties.nGridPoints * sizeof(float),
+                                    DATA_ALIGNMENT);
+
+    // first touch for seq version
+    for (size_t i = 0; i < materialProperties.nGridPoints; i++)
+    {
+        seqResult[i] = 0.0f;
+    }
+
+    // first touch policy
+#pragma omp parallel for
+    for (size_t i = 0; i < materialProperties.nGridPoints; i++)
+    {
+        parResult[i] = 0.0f;
+    }
+
+    // Find or load the fastest configuration of the parallel version
+    bool runNonOverlapped = parameters.IsRunParallelNonOverlapped();
+    bool runOverlapped    = parameters.IsRunParallelOverlapped();
+
+    if ((extParameters.autotune || extParameters.tuned) && (runNonOverlapped || runOverlapped))
+    {
+        const string        profileFileName = GetProfileFileName(extParameters);
+        TTunedConfiguration configuration;
+
+        if (extParameters.autotune)
+        {
+            configuration = AutotuneConfiguration(materialProperties, parameters);
+            StoreTunedConfiguration(profileFileName, configuration);
+        }
+        else if (!LoadTunedConfiguration(profileFileName, materialProperties.edgeSize,
+                                         parameters.outputFileName != "", configuration))
+        {
+            fprintf(stderr, "[ERROR]: No tuned configuration for this domain in %s, run with --autotune.\n",
+                    profileFileName.c_str());
+            exit(EXIT_FAILURE);
+        }
+
+        parameters.nThreads           = configuration.nThreads;
+        parameters.diskWriteIntensity = configuration.diskWriteIntensity;
+        extParameters.nWriterThreads  = configuration.nWriterThreads;
+        omp_set_num_threads(configuration.nThreads);
+
+        runNonOverlapped = !configuration.overlapped;
+        runOverlapped    =  configuration.overlapped;
+
+        if (!parameters.batchMode)
+            printf("Tuned configuration: %s, %zu threads, -w %zu, %zu writer threads (%e s/iteration)\n",
+                   configuration.overlapped ? "overlapped" : "non-overlapped",
+                   configuration.nThreads, configuration.diskWriteIntensity,
+                   configuration.nWriterThreads, configuration.iterationTime);
+    }
+
+    // run sequential version if needed, the golden file replaces it
+    if (extParameters.goldenFileName != "")
+    {
+        try
+        {
+            LoadGoldenFile(extParameters.goldenFileName, seqResult,
+                           materialProperties.edgeSize, parameters.nIterations);
+        }
+        catch (const std::ios::failure& e)
+        {
+            fprintf(stderr, "[ERROR]: Golden file cannot be loaded or does not match the simulation.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if (parameters.IsRunSequntial())
+    {
+        SequentialHeatDistribution(seqResult,
+                                   materialProperties,
+                                   parameters,
+                                   parameters.outputFileName);
+
+        if (extParameters.storeGoldenFileName != "")
+            StoreGoldenFile(extParameters.storeGoldenFileName, seqResult,
+                            materialProperties.edgeSize, parameters.nIterations);
+    }
+    if (runNonOverlapped)
+    {
+        // run the parallel version with non-overlapped file output
+        ParallelHeatDistributionNonOverlapped(parResult,
+                                              materialProperties,
+                                              parameters,
+                                              parameters.outputFileName);
+    }
+    if (runOverlapped)
+    {
+        // run the parallel version with non-overlapped file output
+        ParallelHeatDistributionOverlapped(parResult,
+                                           materialProperties,
+                                           parameters,
+                                           parameters.outputFileName);
+    }
+
+    // Validate the outputs
+    if (parameters.IsValidation())
+    {
+        const TVerificationReport report = CompareResults(seqResult, parResult,
+                                                          materialProperties.edgeSize);
+
+        // big domains are printed only around the worst point
+        if (parameters.debugFlag)
         {
             printf("---------------- Sequential results ---------------\n");
-            PrintArray(seqResult, materialProperties.edgeSize);
+            if (materialProperties.edgeSize <= PRINT_ARRAY_LIMIT)
+                PrintArray(seqResult, materialProperties.edgeSize);
+            else
+                PrintWindow(seqResult, materialProperties.edgeSize, report.worstRow, report.worstCol);
 
             printf("----------------- Parallel results ----------------\n");
-            PrintArray(parResult, materialProperties.edgeSize);
+            if (materialProperties.edgeSize <= PRINT_ARRAY_LIMIT)
+                PrintArray(parResult, materialProperties.edgeSize);
+            else
+                PrintWindow(parResult, materialProperties.edgeSize, report.worstRow, report.worstCol);
+        }
+
+        printf("Max abs error %e, max rel error %e, max ULP distance %u at [%zu, %zu] "
+               "(reference %f, result %f)\n",
+               report.maxAbsError, report.maxRelError, report.maxUlpDistance,
+               report.worstRow, report.worstCol,
+               seqResult[report.worstRow * materialProperties.edgeSize + report.worstCol],
+               parResult[report.worstRow * materialProperties.edgeSize + report.worstCol]);
+
+        if (report.nNonFinite != 0)
+        {
+            printf("%zu points are NaN or Inf\n", report.nNonFinite);
         }
 
-        if (VerifyResults(seqResult, parResult, parameters))
+        if ((report.nNonFinite == 0) && (report.maxAbsError <= VERIFICATION_EPSILON))
         {
             printf("Verification OK \n");
         }
@@ -907,6 +3066,8 @@ int main(int argc, char *argv[])
         }
     }
 
+    CloseMetrics(metricsPublisher);
+
     /* Memory deallocation*/
     _mm_free(seqResult);
     _mm_free(parResult);
@@ -0,0 +1,59 @@
+#!/bin/bash
+#
+# Compare layouts of the parallel HDF5 output by the number of ranks.
+# Every configuration runs the parallel version in the batch mode with
+# parallel I/O, the batch line is prefixed by the layout, the kind of the
+# write and the number of ranks.
+#
+# usage: ./benchmark_io.sh <material file> [iterations] [disk write intensity] [ranks ...]
+#
+# environment:
+#   MPIRUN     - MPI launcher (mpirun)
+#   BINARY     - simulation binary (./proj02)
+#   OUTPUT_DIR - directory of the output files, preferably on the tested file system (.)
+#   ALIGNMENT  - alignment of chunks in bytes, chunked layouts only (1 MiB)
+#   EXTRA_ARGS - additional options, e.g. "--cb-buffer 16777216"
+#
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 <material file> [iterations] [disk write intensity] [ranks ...]" >&2
+    exit 1
+fi
+
+MATERIAL=$1
+ITERATIONS=${2:-1000}
+WRITE_INTENSITY=${3:-10}
+RANKS=${*:4}
+RANKS=${RANKS:-"1 2 4 8 16"}
+
+MPIRUN=${MPIRUN:-mpirun}
+BINARY=${BINARY:-./proj02}
+OUTPUT_DIR=${OUTPUT_DIR:-.}
+ALIGNMENT=${ALIGNMENT:-1048576}
+
+# layout:write
+CONFIGURATIONS="contiguous:collective chunked:collective chunked:independent"
+
+echo "layout;write;nRanks;domainSize;nIterations;nThreads;diskWriteIntensity;airflow;materialFile;simulationOutputFile;simulationMode;avgColumnTemperature;totalTime;iterationTime"
+
+for np in $RANKS; do
+    for configuration in $CONFIGURATIONS; do
+        layout=${configuration%%:*}
+        write=${configuration##*:}
+        output="$OUTPUT_DIR/io_${layout}_${write}_${np}.h5"
+
+        # the contiguous layout rejects the alignment of chunks
+        alignment=""
+        if [ "$layout" == "chunked" ]; then
+            alignment="--alignment $ALIGNMENT"
+        fi
+
+        line=$($MPIRUN -np $np $BINARY -m 1 -b -p \
+                       -n $ITERATIONS -w $WRITE_INTENSITY \
+                       -i "$MATERIAL" -o "$output" \
+                       --layout $layout --write $write $alignment $EXTRA_ARGS | tail -n 1)
+        echo "$layout;$write;$np;$line"
+
+        rm -f "${output%.h5}_par.h5"
+    done
+done
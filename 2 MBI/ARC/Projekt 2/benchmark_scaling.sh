@@ -0,0 +1,85 @@
+#!/bin/bash
+#
+# Strong and weak scaling of the parallel version. Material files are
+# generated by the binary itself (--generate-material), every run uses the
+# batch mode, the batch line (columns of benchmark.csv of the first project)
+# is followed by the number of ranks and the parallel efficiency relative to
+# the first rank count.
+#
+#   strong - the domain of the given edge size on every rank count,
+#            efficiency = (t_first * ranks_first) / (t * ranks)
+#   weak   - the edge size grows with the square root of the rank count, so
+#            every rank keeps the tile of the first rank count,
+#            efficiency = t_first / t
+#
+# usage: ./benchmark_scaling.sh <strong|weak> <edge size> [iterations] [disk write intensity] [ranks ...]
+#
+# environment:
+#   MPIRUN      - MPI launcher (mpirun)
+#   MPIRUN_ARGS - additional options of the launcher, e.g. "--oversubscribe" locally
+#   BINARY      - simulation binary (./proj02)
+#   OUTPUT_DIR  - directory of the material and output files (.)
+#   THREADS     - OpenMP threads per rank (1)
+#   OUTPUT      - write snapshots, 0 runs without the output file (1)
+#   EXTRA_ARGS  - additional options, e.g. "-p --halo p2p"
+#
+
+if [ $# -lt 2 ] || { [ "$1" != "strong" ] && [ "$1" != "weak" ]; }; then
+    echo "usage: $0 <strong|weak> <edge size> [iterations] [disk write intensity] [ranks ...]" >&2
+    exit 1
+fi
+
+SCALING=$1
+EDGE_SIZE=$2
+ITERATIONS=${3:-1000}
+WRITE_INTENSITY=${4:-100}
+RANKS=${*:5}
+RANKS=${RANKS:-"1 2 4 8 16"}
+
+MPIRUN=${MPIRUN:-mpirun}
+BINARY=${BINARY:-./proj02}
+OUTPUT_DIR=${OUTPUT_DIR:-.}
+THREADS=${THREADS:-1}
+OUTPUT=${OUTPUT:-1}
+
+echo "domainSize;nIterations;nThreads;diskWriteIntensity;airflow;materialFile;simulationOutputFile;simulationMode;avgColumnTemperature;totalTime;iterationTime;nRanks;efficiency"
+
+firstRanks=""
+firstTime=""
+
+for np in $RANKS; do
+    if [ "$SCALING" == "strong" ]; then
+        edge=$EDGE_SIZE
+    else
+        edge=$(awk -v e=$EDGE_SIZE -v p=$np 'BEGIN { printf "%d", e * sqrt(p) + 0.5 }')
+    fi
+
+    material="$OUTPUT_DIR/material_${edge}.h5"
+    if [ ! -f "$material" ]; then
+        $BINARY --generate-material "$material" $edge || exit 1
+    fi
+
+    output=""
+    if [ "$OUTPUT" != "0" ]; then
+        output="$OUTPUT_DIR/${SCALING}_${edge}_${np}.h5"
+    fi
+
+    line=$($MPIRUN $MPIRUN_ARGS -np $np $BINARY -m 1 -b -t $THREADS \
+                   -n $ITERATIONS -w $WRITE_INTENSITY \
+                   -i "$material" ${output:+-o "$output"} $EXTRA_ARGS | tail -n 1)
+
+    # the iteration time is the last column of the batch line
+    time=${line##*;}
+    if [ -z "$firstTime" ]; then
+        firstRanks=$np
+        firstTime=$time
+    fi
+
+    efficiency=$(awk -v s=$SCALING -v t0=$firstTime -v p0=$firstRanks -v t=$time -v p=$np \
+                     'BEGIN { if (s == "strong") printf "%f", (t0 * p0) / (t * p); else printf "%f", t0 / t }')
+    echo "$line;$np;$efficiency"
+
+    if [ -n "$output" ]; then
+        rm -f "${output%.h5}_par.h5"
+    fi
+done
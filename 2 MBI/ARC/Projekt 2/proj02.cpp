@@ -21,7 +21,10 @@
 #include <omp.h>
 
 #include <string.h>
+#include <stdint.h>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <cmath>
 
 #include <hdf5.h>
@@ -51,6 +54,268 @@ TParameters parameters;
 /// Material properties
 TMaterialProperties materialProperties;
 
+/// Implementation of the halo exchange
+enum THaloExchangeMode
+{
+    /// Point-to-point messages (MPI_Isend/MPI_Irecv)
+    HALO_P2P      = 0,
+    /// Neighbourhood collective on a distributed graph communicator
+    HALO_NEIGHBOR = 1,
+    /// Shared memory window within a node, point-to-point messages between nodes
+    HALO_SHM      = 2,
+    /// One-sided puts into windows of the neighbours, post/start/complete/wait
+    HALO_RMA      = 3
+};
+
+/// Loading of the material
+enum TMaterialLoading
+{
+    /// Rank 0 loads the whole domain and scatters it
+    LOAD_ROOT     = 0,
+    /// Every rank reads its tile with halo zones by parallel HDF5
+    LOAD_PARALLEL = 1
+};
+
+/// Decomposition of the domain among the ranks
+enum TDecompositionLayout
+{
+    /// 2D grid of tiles given by MPI_Dims_create
+    LAYOUT_TILES  = 0,
+    /// Strips of whole rows, all halos are contiguous rows
+    LAYOUT_STRIPS = 1,
+    /// Strips or tiles selected by the measured latency and bandwidth
+    LAYOUT_AUTO   = 2
+};
+
+/**
+ * Parameters of the simulation not covered by ParseCommandline. They are
+ * given as long options (--name value) and removed from argv before the
+ * standard command line is parsed.
+ */
+struct TExtendedParameters
+{
+    /// Implementation of the halo exchange
+    THaloExchangeMode haloExchange;
+    /// Depth of halo zones in iterations (halos are 2 * depth wide), 0 selects it automatically
+    int               haloDepth;
+    /// Loading of the material
+    TMaterialLoading  materialLoading;
+    /// Number of ranks reserved as I/O servers
+    int               nIOServers;
+    /// Parallel I/O: dataset chunked by tiles instead of a contiguous one
+    bool              chunkedOutput;
+    /// Parallel I/O: alignment of chunks in the file (file system stripe) [bytes]
+    size_t            outputAlignment;
+    /// Parallel I/O: every rank writes its chunk independently
+    bool              independentWrite;
+    /// Parallel I/O: collective buffering hint (cb_buffer_size), 0 keeps the default [bytes]
+    size_t            cbBufferSize;
+    /// CSV file with the phase times of every rank, empty for none
+    string            timingFileName;
+    /// Synthetic material file to generate instead of the simulation, empty for none
+    string            generatedFileName;
+    /// Size of the domain of the generated material file
+    size_t            generatedEdgeSize;
+    /// Checkpoint file written during the simulation, empty for none
+    string            checkpointFileName;
+    /// Number of iterations between checkpoints
+    size_t            checkpointInterval;
+    /// Checkpoint file the simulation is restarted from, empty for none
+    string            restartFileName;
+    /// Rows of the interior computed between two tests of the halo exchange
+    int               progressChunk;
+    /// The master thread only progresses the halo exchange until it completes
+    bool              progressThread;
+    /// Decomposition of the domain, LAYOUT_AUTO is resolved in main
+    TDecompositionLayout decompositionLayout;
+    /// Point-to-point halos: left and right columns packed into contiguous buffers
+    bool              packColumns;
+    /// Point-to-point halos sent in half precision
+    bool              halfHalos;
+
+    TExtendedParameters() : haloExchange(HALO_NEIGHBOR), haloDepth(1), materialLoading(LOAD_ROOT), nIOServers(0),
+                            chunkedOutput(false), outputAlignment(1048576), independentWrite(false), cbBufferSize(0),
+                            timingFileName(""), generatedFileName(""), generatedEdgeSize(0),
+                            checkpointFileName(""), checkpointInterval(1000), restartFileName(""),
+                            progressChunk(4), progressThread(false), decompositionLayout(LAYOUT_TILES),
+                            packColumns(false), halfHalos(false) {}
+};
+
+/// Extended parameters of the simulation
+TExtendedParameters extParameters;
+
+/// Phases of the parallel simulation timed on every rank
+enum TPhase
+{
+    /// Interior of the tile (and the whole tile in iterations without halo exchange)
+    PHASE_INTERIOR  = 0,
+    /// Boundary strips sent to the neighbours
+    PHASE_BOUNDARY  = 1,
+    /// Posting the halo exchange and waiting for it
+    PHASE_HALO_WAIT = 2,
+    /// Average temperature of the middle column
+    PHASE_REDUCTION = 3,
+    /// Tiles gathered to rank 0
+    PHASE_GATHER    = 4,
+    /// Snapshots written (or handed over to the I/O servers)
+    PHASE_WRITE     = 5,
+    /// Number of phases
+    N_PHASES        = 6
+};
+
+/// Names of the phases in the report and in the CSV file
+const char *phaseNames[N_PHASES] = {"interior", "boundary", "haloWait", "reduction", "gather", "write"};
+
+/// Rows of the halo columns packed (unpacked) by one thread at once
+#define PACK_BLOCK_ROWS 64
+
+/// Minimum size of a tile, the tile has to cover the halo zones of both neighbours
+#define MIN_TILE_SIZE 4
+
+/// Maximum depth of halo zones selected automatically
+#define MAX_HALO_DEPTH 16
+/// Number of repetitions of the probes measuring the latency and the computation
+#define HALO_PROBE_REPETITIONS 20
+/// Size of the block computed by the probe of the computation
+#define HALO_PROBE_SIZE 64
+
+/// Layout of snapshots written by parallel HDF5
+struct TOutputLayout
+{
+    /// Chunk of the temperature dataset, 0 x 0 for a contiguous dataset
+    hsize_t chunkDims[2];
+    /// Collective or independent write
+    bool    collectiveWrite;
+};
+
+/// Number of snapshot buffers of a compute rank and of an I/O server
+#define IO_BUFFER_SLOTS 2
+/// Tag of the snapshot tiles sent to I/O servers
+#define TAG_SNAPSHOT 10
+
+/// Ranks reserved for writing snapshots
+struct TIOServers
+{
+    /// Number of I/O servers (the last ranks), 0 if the compute ranks write snapshots
+    int      nServers;
+    /// Number of compute ranks (the first ranks)
+    int      nComputeRanks;
+    /// Communicator of the compute ranks (MPI_COMM_NULL on I/O servers)
+    MPI_Comm computeComm;
+    /// Communicator of the I/O servers (MPI_COMM_NULL on compute ranks)
+    MPI_Comm serverComm;
+};
+
+/// I/O servers of the simulation
+TIOServers ioServers;
+
+/// Tile of a compute rank written by an I/O server
+struct TServerTile
+{
+    /// Compute rank sending the tile
+    int    rank;
+    /// Position and size of the tile in the domain
+    size_t posY, posX, height, width;
+    /// Position of the tile in the snapshot buffer of the server
+    size_t offset;
+};
+
+/// Decomposition of the domain into a Cartesian grid of tiles
+struct TDecomposition
+{
+    /// Communicator with the Cartesian topology (ranks are not reordered, rank 0 stays the root)
+    MPI_Comm cartComm;
+    /// Number of tiles in Y and X
+    int      rows, cols;
+    /// Position of this rank in the grid of tiles
+    int      iIndex, jIndex;
+    /// Size of the tile of this rank (without halo zones)
+    size_t   tileHeight, tileWidth;
+    /// Position of the tile of this rank in the domain
+    size_t   tilePosY, tilePosX;
+    /// Neighbours of this rank (MPI_PROC_NULL at the edges of the domain)
+    int      topRank, bottomRank, leftRank, rightRank;
+    /// Diagonal neighbours of this rank (MPI_PROC_NULL at the edges of the domain)
+    int      topLeftRank, topRightRank, bottomLeftRank, bottomRightRank;
+    /// Width of the halo zones on every side of the tile
+    size_t   haloWidth;
+    /// Distributed graph of the existing neighbours (left, right, top, bottom and the
+    /// diagonal ones for halos deeper than two)
+    MPI_Comm neighbourComm;
+};
+
+/// Halo exchange of one tile array by a neighbourhood collective
+struct THaloExchange
+{
+    /// Communicator of the neighbours
+    MPI_Comm             comm;
+    /// One strip per neighbour
+    vector<int>          counts;
+    /// Position of the boundary strip sent to and the halo received from every neighbour [bytes]
+    vector<MPI_Aint>     sendDispls, recvDispls;
+    /// Type of the strip exchanged with every neighbour
+    vector<MPI_Datatype> types;
+    /// Strips of halo width columns and rows, corner blocks of deep halos
+    MPI_Datatype         columnType, rowType, cornerType;
+    /// Boundary strips are packed into a separate send buffer (MPI forbids aliased
+    /// buffers in collectives): elements sent to every neighbour and their position
+    /// in the send buffer [bytes]
+    vector<int>          sendCounts;
+    vector<MPI_Aint>     packedDispls;
+    vector<MPI_Datatype> sendTypes;
+    /// Blocks of the boundary strips in the tile: first element, rows and columns
+    vector<size_t>       blockOffsets, blockRows, blockCols;
+    /// Size of an element and of a row of the tile with halo zones
+    size_t               elementSize, rowSize;
+    /// Size of the send buffer [bytes]
+    size_t               sendBufferSize;
+};
+
+/// Ping-pong tiles of the ranks of a node in a shared memory window
+struct TSharedTiles
+{
+    /// Communicator of the ranks sharing the node
+    MPI_Comm nodeComm;
+    /// Window with both tiles of every rank of the node
+    MPI_Win  window;
+    /// Both tiles of this rank
+    float   *tiles;
+    /// Both tiles of the left, right, top and bottom neighbour, NULL if it is on another node
+    float   *neighbourTiles[4];
+    /// Size of the tiles of the neighbours (without halo zones)
+    size_t   neighbourHeights[4], neighbourWidths[4];
+};
+
+/// One-sided halo exchange of the ping-pong tiles
+struct TRmaHaloExchange
+{
+    /// Window of every ping-pong tile
+    MPI_Win      windows[2];
+    /// Left, right, top and bottom neighbours, both the origins and the targets
+    MPI_Group    neighbourGroup;
+    /// Number of existing neighbours
+    int          nTargets;
+    /// Rank of every existing neighbour
+    int          targetRanks[4];
+    /// Position of the boundary strip put to the neighbour [elements]
+    size_t       originOffsets[4];
+    /// Position of the halo of the neighbour the strip is put to [elements]
+    MPI_Aint     targetDispls[4];
+    /// Types of the strip in this tile and in the tile of the neighbour
+    MPI_Datatype originTypes[4], targetTypes[4];
+};
+
+/// Datatypes moving tiles between the domain on rank 0 and the ranks
+struct TTileTypes
+{
+    /// Tile without halo zones inside the local array with halo zones
+    MPI_Datatype         tileType;
+    /// Tile of every rank inside the domain (rank 0 only)
+    vector<MPI_Datatype> domainTileTypes;
+    /// Type of one element
+    MPI_Datatype         elementType;
+};
+
 
 //----------------------------------------------------------------------------//
 //------------------------- Function declarations ----------------------------//
@@ -68,6 +333,195 @@ void ParallelHeatDistribution(float                     *parResult,
                               const TParameters         &parameters,
                               string                     outputFileName);
 
+/// Get the grid of tiles of the decomposition
+void GetDecompositionDims(const int nRanks,
+                          int       dims[2]);
+
+/// Select strips or tiles from the measured latency and bandwidth
+bool SelectStripDecomposition(MPI_Comm     comm,
+                              const size_t edgeSize);
+
+/// Split the domain into a Cartesian grid of tiles
+void CreateDecomposition(TDecomposition &decomposition,
+                         const size_t    edgeSize,
+                         MPI_Comm        comm);
+
+/// Set the width of halo zones and create the graph of the neighbours
+void CreateNeighbourGraph(TDecomposition &decomposition,
+                          const int       haloDepth);
+
+/// Get the neighbours halos are exchanged with
+void GetHaloNeighbours(const TDecomposition &decomposition,
+                       int                   neighbours[8]);
+
+/// Select the depth of halo zones from the measured latency and computation
+int SelectHaloDepth(const TDecomposition &decomposition,
+                    const TParameters    &parameters);
+
+/// Get the start and the size of one of the blocks the range is split into
+void GetBlockRange(const size_t  length,
+                   const int     nBlocks,
+                   const int     blockId,
+                   size_t       &start,
+                   size_t       &blockSize);
+
+/// Create datatypes for scattering and gathering the tiles
+void CreateTileTypes(TTileTypes           &tileTypes,
+                     const TDecomposition &decomposition,
+                     const size_t          edgeSize,
+                     MPI_Datatype          elementType);
+
+/// Free datatypes of the tiles
+void FreeTileTypes(TTileTypes &tileTypes);
+
+/// Create the halo exchange of tile arrays with the given element type
+void CreateHaloExchange(THaloExchange        &haloExchange,
+                        const TDecomposition &decomposition,
+                        MPI_Datatype          elementType);
+
+/// Free the halo exchange
+void FreeHaloExchange(THaloExchange &haloExchange);
+
+/// Allocate both tiles in a shared memory window of the node
+void CreateSharedTiles(TSharedTiles         &sharedTiles,
+                       const TDecomposition &decomposition,
+                       const size_t          edgeSize);
+
+/// Free the shared memory window
+void FreeSharedTiles(TSharedTiles &sharedTiles);
+
+/// Copy halos from the tiles of the neighbours on the same node
+void CopySharedHalos(const TSharedTiles   &sharedTiles,
+                     const TDecomposition &decomposition,
+                     float                *tile,
+                     const int             tileIndex);
+
+/// Create the one-sided halo exchange of the ping-pong tiles
+void CreateRmaHaloExchange(TRmaHaloExchange     &rmaHaloExchange,
+                           const TDecomposition &decomposition,
+                           const size_t          edgeSize,
+                           float                *tiles[2]);
+
+/// Free the one-sided halo exchange
+void FreeRmaHaloExchange(TRmaHaloExchange &rmaHaloExchange);
+
+/// Pack a block of rows of two wide columns into a contiguous buffer
+void PackColumns(const float  *column,
+                 float        *buffer,
+                 const size_t  rowSize,
+                 const size_t  firstRow,
+                 const size_t  nRows);
+
+/// Unpack a block of rows of two wide columns from a contiguous buffer
+void UnpackColumns(const float  *buffer,
+                   float        *column,
+                   const size_t  rowSize,
+                   const size_t  firstRow,
+                   const size_t  nRows);
+
+/// Round a float to the nearest half precision value
+uint16_t FloatToHalf(const float value);
+
+/// Widen a half precision value to a float
+float HalfToFloat(const uint16_t value);
+
+/// Convert an array of floats to half precision
+void ConvertToHalf(const float  *source,
+                   uint16_t     *destination,
+                   const size_t  size);
+
+/// Convert an array of half precision values to floats
+void ConvertFromHalf(const uint16_t *source,
+                     float          *destination,
+                     const size_t    size);
+
+/// Test whether the halo exchange completed, progress it otherwise
+bool TestHaloExchange(const int    nRequests,
+                      MPI_Request *requests,
+                      MPI_Win      exposureWindow);
+
+/// Put boundary strips of the tile into the halos of the neighbours
+void StartRmaHaloExchange(const TRmaHaloExchange &rmaHaloExchange,
+                          const float            *tile,
+                          const int               tileIndex);
+
+/// Start the exchange of halos of the tile array
+void StartHaloExchange(const THaloExchange &haloExchange,
+                       void                *tile,
+                       void                *sendBuffer,
+                       MPI_Request         *request);
+
+/// Hand the tile over to its I/O server
+void SendSnapshotTile(const float          *tile,
+                      const TDecomposition &decomposition,
+                      const size_t          snapshotId,
+                      float                *slots,
+                      MPI_Request          *requests);
+
+/// Receive the tiles of the compute ranks and write snapshots
+void RunIOServer(const TParameters &parameters,
+                 const size_t       edgeSize,
+                 string             outputFileName);
+
+/// Post receives of one snapshot of the tiles of an I/O server
+void PostSnapshotReceives(const vector<TServerTile> &tiles,
+                          float                     *buffer,
+                          MPI_Request               *requests);
+
+/// Gather the phase times of all ranks and report them on rank 0
+void ReportPhaseTimes(const double  phaseTimes[N_PHASES],
+                      const double  haloInFlight,
+                      const double  haloExposed,
+                      MPI_Comm      comm,
+                      const bool    printReport,
+                      const string &csvFileName);
+
+/// Parse extended parameters and remove them from argv
+void ParseExtendedCommandline(int                 &argc,
+                              char                *argv[],
+                              TExtendedParameters &extParameters);
+
+/// Scatter the domain from rank 0 into the tiles
+void ScatterTiles(const void           *domain,
+                  void                 *tile,
+                  const TTileTypes     &tileTypes,
+                  const TDecomposition &decomposition);
+
+/// Read the tile of every rank with halo zones from the material file
+void LoadMaterialTiles(const string         &fileName,
+                       const TDecomposition &decomposition,
+                       const size_t          edgeSize,
+                       float                *tempTile,
+                       float                *paramsTile,
+                       int                  *mapTile);
+
+/// Get the hyperslab of the tile with halo zones clipped to the domain
+void GetTileHyperslab(const TDecomposition &decomposition,
+                      const size_t          edgeSize,
+                      hsize_t               fileOffset[2],
+                      hsize_t               blockDims[2],
+                      hsize_t               localDims[2],
+                      hsize_t               localOffset[2]);
+
+/// Write the tiles of all ranks and the iteration into a checkpoint file
+void StoreCheckpoint(const string         &fileName,
+                     const float          *tile,
+                     const TDecomposition &decomposition,
+                     const size_t          edgeSize,
+                     const size_t          nextIteration);
+
+/// Read the tile with halo zones from a checkpoint file of any decomposition
+size_t LoadCheckpointTile(const string         &fileName,
+                          const TDecomposition &decomposition,
+                          const size_t          edgeSize,
+                          float                *tile);
+
+/// Gather the tiles into the domain on rank 0
+void GatherTiles(const void           *tile,
+                 void                 *domain,
+                 const TTileTypes     &tileTypes,
+                 const TDecomposition &decomposition);
+
 /// Store time step into output file
 void StoreDataIntoFile(hid_t         h5fileId,
                        const float * data,
@@ -80,9 +534,39 @@ void StoreDataIntoFileParallel(hid_t h5fileId,
                                const float *data,
                                const size_t edgeSize,
                                const size_t tileWidth, const size_t tileHeight,
+                               const size_t haloWidth,
                                const size_t tilePosX, const size_t tilePosY,
                                const size_t snapshotId,
-                               const size_t iteration);
+                               const size_t iteration,
+                               const TOutputLayout &layout);
+
+/// Store time step of tiles of an I/O server into output file using parallel HDF5
+void StoreTilesIntoFileParallel(hid_t                      h5fileId,
+                                const float               *data,
+                                const size_t               edgeSize,
+                                const vector<TServerTile> &tiles,
+                                const size_t               snapshotId,
+                                const size_t               iteration);
+
+/// Create the output file, a restarted simulation opens the existing one
+hid_t OpenOutputFile(const string &fileName,
+                     hid_t         accessList,
+                     const bool    restart);
+
+/// Remove the snapshots from the given one on (written again after a restart)
+void RemoveSnapshots(hid_t        h5fileId,
+                     const size_t firstSnapshot);
+
+/// Generate a synthetic material file for benchmarks
+void GenerateMaterialFile(const string &fileName,
+                          const size_t  edgeSize);
+
+/// Write one dataset of the material file
+void WriteMaterialDataset(hid_t         h5fileId,
+                          const char   *datasetName,
+                          hid_t         typeId,
+                          const size_t  edgeSize,
+                          const void   *data);
 
 
 //----------------------------------------------------------------------------//
@@ -300,15 +784,17 @@ void ParallelHeatDistribution(float                     *parResult,
 #define TAG_TOP 2 //from top to bottom
 #define TAG_BOTTOM 3 //from bottom to top
 
-    // Get MPI rank and size
+    // Get MPI rank and size (I/O servers do not compute)
     int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
-    MPI_Status status;
+    MPI_Comm_rank(ioServers.computeComm, &rank);
+    MPI_Comm_size(ioServers.computeComm, &size);
 
     /************************************** Open file for writing ********************************************/
     hid_t file_id = H5I_INVALID_HID;
-    if(!parameters.useParallelIO) //open with only one process
+    if(ioServers.nServers > 0) //the file is opened by the I/O servers (RunIOServer)
+    {
+    }
+    else if(!parameters.useParallelIO) //open with only one process
     {
         // Serial I/O
         if(rank == 0 && outputFileName != "")
@@ -318,10 +804,7 @@ void ParallelHeatDistribution(float                     *parResult,
             else
                 outputFileName.insert(outputFileName.find_last_of("."), "_par");
 
-            file_id = H5Fcreate(outputFileName.c_str(),
-                                H5F_ACC_TRUNC,
-                                H5P_DEFAULT,
-                                H5P_DEFAULT);
+            file_id = OpenOutputFile(outputFileName, H5P_DEFAULT, extParameters.restartFileName != "");
             if(file_id < 0) ios::failure("Cannot create output file");
         }
     }
@@ -335,13 +818,24 @@ void ParallelHeatDistribution(float                     *parResult,
             else
                 outputFileName.insert(outputFileName.find_last_of("."), "_par");
 
+            //Hint for the collective buffering of MPI-IO
+            MPI_Info info = MPI_INFO_NULL;
+            if(extParameters.cbBufferSize > 0)
+            {
+                MPI_Info_create(&info);
+                MPI_Info_set(info, "cb_buffer_size", to_string((unsigned long long) extParameters.cbBufferSize).c_str());
+            }
+
             hid_t hPropList = H5Pcreate(H5P_FILE_ACCESS);
-            H5Pset_fapl_mpio(hPropList, MPI_COMM_WORLD, MPI_INFO_NULL);
+            H5Pset_fapl_mpio(hPropList, ioServers.computeComm, info);
+            //Chunks of at least half a stripe start on a stripe boundary
+            if(extParameters.chunkedOutput)
+            {
+                H5Pset_alignment(hPropList, extParameters.outputAlignment / 2, extParameters.outputAlignment);
+            }
+            if(info != MPI_INFO_NULL) MPI_Info_free(&info);
 
-            file_id = H5Fcreate(outputFileName.c_str(),
-                                H5F_ACC_TRUNC,
-                                H5P_DEFAULT,
-                                hPropList);
+            file_id = OpenOutputFile(outputFileName, hPropList, extParameters.restartFileName != "");
             H5Pclose(hPropList);
             if(file_id < 0) ios::failure("Cannot create output file");
         }
@@ -350,44 +844,61 @@ void ParallelHeatDistribution(float                     *parResult,
 
     size_t dimension = materialProperties.edgeSize; //todo remove ///////////////////////////////////////////////////
 
-    float *domainParamsTemp;
-    float *domainMapTemp;
     if(rank == 0)
     {
-        domainParamsTemp = (float *) _mm_malloc(dimension * dimension * sizeof(float), DATA_ALIGNMENT);
-        domainMapTemp = (float *) _mm_malloc(dimension * dimension * sizeof(float), DATA_ALIGNMENT);
-        for (size_t i = 0; i < dimension * dimension; i++) {
-            parResult[i] = materialProperties.initTemp[i];
-            domainParamsTemp[i] = materialProperties.domainParams[i];
-            domainMapTemp[i] = materialProperties.domainMap[i];
+        //Parallel loading leaves the domain on rank 0 for gathering the result only
+        if(extParameters.materialLoading == LOAD_ROOT)
+        {
+            for (size_t i = 0; i < dimension * dimension; i++) {
+                parResult[i] = materialProperties.initTemp[i];
+            }
         }
         if (!parameters.batchMode)
             printf("Starting parallel simulation... \n");
     }
 
-    //Dimensions
-    size_t tileWidth = 0;
-    size_t tileHeight = 0;
-    if(sqrt(size) == floor(sqrt(size))) { //even power (suda,parna)
-        tileHeight = dimension/sqrt(size);
-        tileWidth = dimension/sqrt(size);
-    } else { //odd power (licha neparna)
-        tileHeight = dimension/(2*sqrt(size/2));
-        tileWidth = dimension/((sqrt(size/2)));
-    }
+    //Dimensions and indexes given by the Cartesian topology, tiles may differ by one row/column
+    TDecomposition decomposition;
+    CreateDecomposition(decomposition, dimension, ioServers.computeComm);
 
-    //Indexes
-    int cols = dimension/(tileWidth);
-    int rows = dimension/(tileHeight);
-    int iIndex = rank/cols;
-    int jIndex = rank%cols;
+    //Deep halos: 2 * haloDepth wide, exchanged once per haloDepth iterations
+    const int haloDepth = (extParameters.haloDepth > 0) ? extParameters.haloDepth
+                                                        : SelectHaloDepth(decomposition, parameters);
+    CreateNeighbourGraph(decomposition, haloDepth);
+    if(rank == 0 && !parameters.batchMode && extParameters.haloDepth != 1)
+    {
+        printf("Halo depth %d (%s)\n", haloDepth, (extParameters.haloDepth > 0) ? "given" : "auto");
+    }
 
-    //Tiles arrays
-    float *newTile = (float *) malloc((tileWidth + HALOZONE) * (tileHeight + HALOZONE) * sizeof(float));
-    float *oldTile = (float *) malloc((tileWidth + HALOZONE) * (tileHeight + HALOZONE) * sizeof(float));
-    float *domainParamsTile = (float *) malloc((tileWidth + HALOZONE) * (tileHeight + HALOZONE) * sizeof(float));
-    int *domainMapTile = (int *) malloc((tileWidth + HALOZONE) * (tileHeight + HALOZONE) * sizeof(int));
-    for(int i = 0; i < (tileWidth + HALOZONE) * (tileHeight + HALOZONE); i++)
+    MPI_Comm cartComm = decomposition.cartComm;
+    size_t tileWidth = decomposition.tileWidth;
+    size_t tileHeight = decomposition.tileHeight;
+    int cols = decomposition.cols;
+    int rows = decomposition.rows;
+    int iIndex = decomposition.iIndex;
+    int jIndex = decomposition.jIndex;
+    const int haloWidth = decomposition.haloWidth;
+    const size_t rowSize = tileWidth + 2 * haloWidth;
+    const size_t localSize = rowSize * (tileHeight + 2 * haloWidth);
+
+    //Tiles arrays, the ping-pong tiles are shared by the ranks of a node in the shm mode
+    const bool sharedMemory = (extParameters.haloExchange == HALO_SHM);
+    TSharedTiles sharedTiles;
+    float *newTile, *oldTile;
+    if(sharedMemory)
+    {
+        CreateSharedTiles(sharedTiles, decomposition, dimension);
+        newTile = sharedTiles.tiles;
+        oldTile = sharedTiles.tiles + localSize;
+    }
+    else
+    {
+        newTile = (float *) malloc(localSize * sizeof(float));
+        oldTile = (float *) malloc(localSize * sizeof(float));
+    }
+    float *domainParamsTile = (float *) malloc(localSize * sizeof(float));
+    int *domainMapTile = (int *) malloc(localSize * sizeof(int));
+    for(int i = 0; i < localSize; i++)
     {
         newTile[i] = -1000; //todo
         oldTile[i] = -1000;
@@ -395,60 +906,30 @@ void ParallelHeatDistribution(float                     *parResult,
         domainMapTile[i] = -1000;
     }
 
-    /********** Scaterv ********************/
-    //Tile with halos
-    int dimensions1[2] = {dimension, dimension}; //of whole grid
-    int tileDimensions1[2] = {tileHeight, tileWidth}; //of tile
-    int tileStart1[2] = {0,0}; //where tile start
-    MPI_Datatype type1, haloTileType;
-    MPI_Type_create_subarray(2, dimensions1, tileDimensions1, tileStart1, MPI_ORDER_C, MPI_FLOAT, &type1);
-    MPI_Type_create_resized(type1, 0, sizeof(float), &haloTileType);
-    MPI_Type_commit(&haloTileType);
+    /********** Scatter ********************/
+    //Per-rank tile types (uneven tiles), the map is scattered as integers
+    TTileTypes floatTileTypes, intTileTypes;
+    CreateTileTypes(floatTileTypes, decomposition, dimension, MPI_FLOAT);
+    CreateTileTypes(intTileTypes, decomposition, dimension, MPI_INT);
 
-    //Tile without halos
-    int dimensions2[2] = {tileHeight + HALOZONE, tileWidth + HALOZONE}; //of whole grid
-    int tileDimensions2[2] = {tileHeight, tileWidth}; //of tile
-    int tileStart2[2] = {0,0}; //where tile start
-    MPI_Datatype type2, tileType;
-    MPI_Type_create_subarray(2, dimensions2, tileDimensions2, tileStart2, MPI_ORDER_C, MPI_FLOAT, &type2);
-    MPI_Type_create_resized(type2, 0, sizeof(float), &tileType);
-    MPI_Type_commit(&tileType);
-
-    float *dataPtr = NULL;
-    float *domainParamsPtr = NULL;
-    float *domainMapPtr = NULL;
-    if (rank == 0)
+    float *dataPtr = (rank == 0) ? parResult : NULL; //adress on start of grid
+
+    if(extParameters.materialLoading == LOAD_ROOT)
     {
-        dataPtr = &(parResult[0]); //adress on start of grid
-        domainParamsPtr = &(domainParamsTemp[0]);
-        domainMapPtr = &(domainMapTemp[0]);
+        ScatterTiles(dataPtr, oldTile, floatTileTypes, decomposition);
+        ScatterTiles(materialProperties.domainParams, domainParamsTile, floatTileTypes, decomposition);
+        ScatterTiles(materialProperties.domainMap, domainMapTile, intTileTypes, decomposition);
     }
-
-    int sendcounts[size];
-    int displs[size];
-
-    if (rank == 0)
+    else
     {
-        for (int i = 0; i < size; i++)
-        {
-            sendcounts[i] = 1; //how much data send to processes, only one data of subArrType
-        }
-        int offset = 0;
-        for (int i = 0 ; i < rows; i++)
-        {
-            for (int j = 0; j < cols; j++)
-            {
-                displs[i * cols + j] = (tileHeight * tileWidth * cols * i) + (tileWidth * j);
-            }
-        }
+        //Tiles are read with their halo zones, no exchange is needed
+        LoadMaterialTiles(parameters.materialFileName, decomposition, dimension,
+                          oldTile, domainParamsTile, domainMapTile);
     }
-
-    MPI_Scatterv(dataPtr, sendcounts, displs, haloTileType, &(oldTile[2 * (tileWidth + HALOZONE) + 2]), 1, tileType, 0, MPI_COMM_WORLD);
-    MPI_Scatterv(domainParamsPtr, sendcounts, displs, haloTileType, &(domainParamsTile[2 * (tileWidth + HALOZONE) + 2]), 1, tileType, 0, MPI_COMM_WORLD);
-    MPI_Scatterv(domainMapPtr, sendcounts, displs, haloTileType, &(domainMapTile[2 * (tileWidth + HALOZONE) + 2]), 1, tileType, 0, MPI_COMM_WORLD);
     /***************************************/
 
     /*********** Send halozones ************/
+    //Point-to-point halo types, two wide halos only (see ParseExtendedCommandline)
     //Vertical halozone
     int dimensions3[2] = {tileHeight + HALOZONE, tileWidth + HALOZONE}; //of whole grid
     int tileDimensions3[2] = {tileHeight, 2}; //of tile
@@ -458,70 +939,64 @@ void ParallelHeatDistribution(float                     *parResult,
     MPI_Type_create_resized(type3, 0, sizeof(float), &horizontalHaloType);
     MPI_Type_commit(&horizontalHaloType);
 
-    //Horizontal halozone
+    //Horizontal halozone, strips send whole rows with the halo columns (contiguous)
+    const bool strips = (cols == 1);
+    const int rowHaloStart = strips ? 0 : 2;
     int dimensions4[2] = {tileHeight + HALOZONE, tileWidth + HALOZONE}; //of whole grid
-    int tileDimensions4[2] = {2, tileWidth}; //of tile
+    int tileDimensions4[2] = {2, strips ? tileWidth + HALOZONE : tileWidth}; //of tile
     int tileStart4[2] = {0,0}; //where tile start
     MPI_Datatype type4, verticalHaloType;
     MPI_Type_create_subarray(2, dimensions4, tileDimensions4, tileStart4, MPI_ORDER_C, MPI_FLOAT, &type4);
     MPI_Type_create_resized(type4, 0, sizeof(float), &verticalHaloType);
     MPI_Type_commit(&verticalHaloType);
 
-    //Left halozone
-    if(jIndex != cols - 1)
-    {
-        MPI_Send(&(oldTile[2 * (tileWidth + HALOZONE) + tileWidth]), 1, horizontalHaloType, (iIndex * cols) + (jIndex + 1), TAG_LEFT, MPI_COMM_WORLD);
-        MPI_Send(&(domainParamsTile[2 * (tileWidth + HALOZONE) + tileWidth]), 1, horizontalHaloType, (iIndex * cols) + (jIndex + 1), TAG_LEFT + 10, MPI_COMM_WORLD);
-        MPI_Send(&(domainMapTile[2 * (tileWidth + HALOZONE) + tileWidth]), 1, horizontalHaloType, (iIndex * cols) + (jIndex + 1), TAG_LEFT + 20, MPI_COMM_WORLD);
-    }
-    if(jIndex != 0)
-    {
-        MPI_Recv(&(oldTile[2 * (tileWidth + HALOZONE) + 0]), 1, horizontalHaloType, (iIndex * cols) + (jIndex - 1), TAG_LEFT, MPI_COMM_WORLD, &status);
-        MPI_Recv(&(domainParamsTile[2 * (tileWidth + HALOZONE) + 0]), 1, horizontalHaloType, (iIndex * cols) + (jIndex - 1), TAG_LEFT + 10, MPI_COMM_WORLD, &status);
-        MPI_Recv(&(domainMapTile[2 * (tileWidth + HALOZONE) + 0]), 1, horizontalHaloType, (iIndex * cols) + (jIndex - 1), TAG_LEFT + 20, MPI_COMM_WORLD, &status);
-    }
-    //Right halozone
-    if(jIndex != 0)
-    {
-        MPI_Send(&(oldTile[2 * (tileWidth + HALOZONE) + 2]), 1, horizontalHaloType, (iIndex * cols) + (jIndex - 1), TAG_RIGHT, MPI_COMM_WORLD);
-        MPI_Send(&(domainParamsTile[2 * (tileWidth + HALOZONE) + 2]), 1, horizontalHaloType, (iIndex * cols) + (jIndex - 1), TAG_RIGHT + 10, MPI_COMM_WORLD);
-        MPI_Send(&(domainMapTile[2 * (tileWidth + HALOZONE) + 2]), 1, horizontalHaloType, (iIndex * cols) + (jIndex - 1), TAG_RIGHT + 20, MPI_COMM_WORLD);
-    }
-    if(jIndex != cols - 1)
-    {
-        MPI_Recv(&(oldTile[2 * (tileWidth + HALOZONE) + tileWidth + 2]), 1, horizontalHaloType, (iIndex * cols) + (jIndex + 1), TAG_RIGHT, MPI_COMM_WORLD, &status);
-        MPI_Recv(&(domainParamsTile[2 * (tileWidth + HALOZONE) + tileWidth + 2]), 1, horizontalHaloType, (iIndex * cols) + (jIndex + 1), TAG_RIGHT + 10, MPI_COMM_WORLD, &status);
-        MPI_Recv(&(domainMapTile[2 * (tileWidth + HALOZONE) + tileWidth + 2]), 1, horizontalHaloType, (iIndex * cols) + (jIndex + 1), TAG_RIGHT + 20, MPI_COMM_WORLD, &status);
-    }
-    //Top halozone
-    if(iIndex != rows - 1)
-    {
-        MPI_Send(&(oldTile[(tileHeight) * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex + 1) * cols) + (jIndex), TAG_TOP, MPI_COMM_WORLD);
-        MPI_Send(&(domainParamsTile[(tileHeight) * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex + 1) * cols) + (jIndex), TAG_TOP + 10, MPI_COMM_WORLD);
-        MPI_Send(&(domainMapTile[(tileHeight) * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex + 1) * cols) + (jIndex), TAG_TOP + 20, MPI_COMM_WORLD);
-    }
-    if(iIndex != 0)
-    {
-        MPI_Recv(&(oldTile[0 * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex - 1) * cols) + (jIndex), TAG_TOP, MPI_COMM_WORLD, &status);
-        MPI_Recv(&(domainParamsTile[0 * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex - 1) * cols) + (jIndex), TAG_TOP + 10, MPI_COMM_WORLD, &status);
-        MPI_Recv(&(domainMapTile[0 * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex - 1) * cols) + (jIndex), TAG_TOP + 20, MPI_COMM_WORLD, &status);
-    }
-    //Bottom halozone
-    if(iIndex != 0)
+    //Halo exchange engines, the map has its own because of the element type
+    THaloExchange floatHaloExchange, intHaloExchange;
+    CreateHaloExchange(floatHaloExchange, decomposition, MPI_FLOAT);
+    CreateHaloExchange(intHaloExchange, decomposition, MPI_INT);
+
+    //Send buffer of the boundary strips of every exchange in flight
+    vector<char> haloSendBuffers[3];
+    haloSendBuffers[0].resize(floatHaloExchange.sendBufferSize);
+    haloSendBuffers[1].resize(floatHaloExchange.sendBufferSize);
+    haloSendBuffers[2].resize(intHaloExchange.sendBufferSize);
+
+    //Initial temperature and material halos, all three exchanges in flight at once
+    if(extParameters.materialLoading == LOAD_ROOT)
     {
-        MPI_Send(&(oldTile[2 * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex - 1) * cols) + (jIndex), TAG_BOTTOM, MPI_COMM_WORLD);
-        MPI_Send(&(domainParamsTile[2 * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex - 1) * cols) + (jIndex), TAG_BOTTOM + 10, MPI_COMM_WORLD);
-        MPI_Send(&(domainMapTile[2 * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex - 1) * cols) + (jIndex), TAG_BOTTOM + 20, MPI_COMM_WORLD);
+        MPI_Request initRequests[3];
+        StartHaloExchange(floatHaloExchange, oldTile, haloSendBuffers[0].data(), &initRequests[0]);
+        StartHaloExchange(floatHaloExchange, domainParamsTile, haloSendBuffers[1].data(), &initRequests[1]);
+        StartHaloExchange(intHaloExchange, domainMapTile, haloSendBuffers[2].data(), &initRequests[2]);
+        MPI_Waitall(3, initRequests, MPI_STATUSES_IGNORE);
     }
-    if(iIndex != rows - 1)
+
+    //Restart: the temperature with halo zones from the checkpoint replaces the initial one
+    size_t startIteration = 0;
+    if(extParameters.restartFileName != "")
     {
-        MPI_Recv(&(oldTile[(tileHeight + 2) * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex + 1) * cols) + (jIndex), TAG_BOTTOM, MPI_COMM_WORLD, &status);
-        MPI_Recv(&(domainParamsTile[(tileHeight + 2) * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex + 1) * cols) + (jIndex), TAG_BOTTOM + 10, MPI_COMM_WORLD, &status);
-        MPI_Recv(&(domainMapTile[(tileHeight + 2) * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex + 1) * cols) + (jIndex), TAG_BOTTOM + 20, MPI_COMM_WORLD, &status);
+        startIteration = LoadCheckpointTile(extParameters.restartFileName, decomposition, dimension, oldTile);
+        if(rank == 0 && !parameters.batchMode)
+        {
+            printf("Restarted from %s at iteration %zu\n", extParameters.restartFileName.c_str(), startIteration);
+        }
+
+        //Snapshots from the first one of the restarted run on are written again,
+        //the I/O servers count them from the same iteration
+        const size_t firstSnapshot = (startIteration + parameters.diskWriteIntensity - 1) / parameters.diskWriteIntensity;
+        if(file_id != H5I_INVALID_HID)
+        {
+            RemoveSnapshots(file_id, firstSnapshot);
+        }
+        if(ioServers.nServers > 0 && outputFileName != "")
+        {
+            unsigned long long restartIteration = startIteration;
+            MPI_Bcast(&restartIteration, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+        }
     }
 
     //Copy oldTile to newTile
-    for(int i = 0; i < (tileWidth + 4) * (tileHeight + 4); i++)
+    for(int i = 0; i < localSize; i++)
     {
         newTile[i] = oldTile[i];
     }
@@ -529,22 +1004,22 @@ void ParallelHeatDistribution(float                     *parResult,
     //Left halozone
     /*if(jIndex != cols - 1)
     {
-        MPI_Send(&(newTile[2 * (tileWidth + HALOZONE) + tileWidth]), 1, horizontalHaloType, (iIndex * cols) + (jIndex + 1), TAG_LEFT, MPI_COMM_WORLD);
+        MPI_Send(&(newTile[2 * (tileWidth + HALOZONE) + tileWidth]), 1, horizontalHaloType, decomposition.rightRank, TAG_LEFT, cartComm);
     }
     //Right halozone
     if(jIndex != 0)
     {
-        MPI_Send(&(newTile[2 * (tileWidth + HALOZONE) + 2]), 1, horizontalHaloType, (iIndex * cols) + (jIndex - 1), TAG_RIGHT, MPI_COMM_WORLD);
+        MPI_Send(&(newTile[2 * (tileWidth + HALOZONE) + 2]), 1, horizontalHaloType, decomposition.leftRank, TAG_RIGHT, cartComm);
     }
     //Top halozone
     if(iIndex != rows - 1)
     {
-        MPI_Send(&(newTile[(tileHeight) * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex + 1) * cols) + (jIndex), TAG_TOP, MPI_COMM_WORLD);
+        MPI_Send(&(newTile[(tileHeight) * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, decomposition.bottomRank, TAG_TOP, cartComm);
     }
     //Bottom halozone
     if(iIndex != 0)
     {
-        MPI_Send(&(newTile[2 * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex - 1) * cols) + (jIndex), TAG_BOTTOM, MPI_COMM_WORLD);
+        MPI_Send(&(newTile[2 * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, decomposition.topRank, TAG_BOTTOM, cartComm);
     }*/
 
     /**********************************************/
@@ -556,50 +1031,219 @@ void ParallelHeatDistribution(float                     *parResult,
         elapsedTime = MPI_Wtime();
     }
 
+    //Time of every phase on this rank, the master thread measures the hybrid ones
+    double phaseTimes[N_PHASES] = {0.0};
+    double phaseStart;
+    //Time the halo exchange was in flight and the part of it not hidden behind the interior
+    double haloInFlight = 0.0, haloExposed = 0.0;
+    //The master thread of the team as a progress thread (at least two threads, see main)
+    const bool progressThread = extParameters.progressThread;
+
     float middleColAvgTemp = 0.0f;
+    float middleColSum = 0.0f;
     float tileMiddleColAvgTemp = 0.0f;
     size_t printCounter = 1;
 
-    //For indexes
-    int iStart = (iIndex == 0)? 4 : 2;
-    int iEnd = (iIndex == rows - 1)? tileHeight : tileHeight + 2;
-    int jStart = (jIndex == 0)? 4 : 2;
-    int jEnd = (jIndex == cols - 1)? tileWidth : tileWidth + 2;
+    //Does the tile contain the middle column?
+    const bool middleColTile = (decomposition.tilePosX <= dimension / 2) &&
+                               (dimension / 2 < decomposition.tilePosX + tileWidth);
+
+    //Only the tiles with the middle column and rank 0 printing it take part in its reduction
+    MPI_Comm middleColComm;
+    MPI_Comm_split(cartComm, (middleColTile || rank == 0) ? 0 : MPI_UNDEFINED, rank, &middleColComm);
+    MPI_Request middleColRequest = MPI_REQUEST_NULL;
+
+    //Interior of the tile, edges of the domain are not computed
+    const int iInStart = (iIndex == 0)? haloWidth + 2 : 2 * haloWidth;
+    const int iInEnd = (iIndex == rows - 1)? haloWidth + tileHeight - 2 : tileHeight;
+    const int jInStart = (jIndex == 0)? haloWidth + 2 : 2 * haloWidth;
+    const int jInEnd = (jIndex == cols - 1)? haloWidth + tileWidth - 2 : tileWidth;
 
     MPI_Request requests[8];
-    MPI_Status statuses[8];
-    int counter = 0;
-    MPI_Request requests2[8];
-    MPI_Status statuses2[8];
-    int counter2 = 0;
-    int iteration;
-    for (iteration = 0; iteration < parameters.nIterations - 1; iteration++) //todo parameters.nIterations
-    { //todo start
-        counter = 0;
-        counter2 = 0;
-        //Left halozone
-        if(jIndex != 0)
-        {
-            MPI_Irecv(&(newTile[2 * (tileWidth + HALOZONE) + 0]), 1, horizontalHaloType, (iIndex * cols) + (jIndex - 1), TAG_LEFT, MPI_COMM_WORLD, &requests[counter]);
-            counter++;
-        }
-        //Right halozone
-        if(jIndex != cols - 1)
+
+    //Chunks of the parallel output: the tile of rank 0 is the largest one, tiles are the chunks
+    //exactly if the grid divides the domain, otherwise the smaller tiles cross chunk boundaries
+    TOutputLayout outputLayout;
+    outputLayout.chunkDims[0] = 0;
+    outputLayout.chunkDims[1] = 0;
+    outputLayout.collectiveWrite = !extParameters.independentWrite;
+    if(extParameters.chunkedOutput)
+    {
+        size_t chunkPos, chunkHeight, chunkWidth;
+        GetBlockRange(dimension, rows, 0, chunkPos, chunkHeight);
+        GetBlockRange(dimension, cols, 0, chunkPos, chunkWidth);
+        outputLayout.chunkDims[0] = chunkHeight;
+        outputLayout.chunkDims[1] = chunkWidth;
+    }
+
+    //Snapshot buffers handed over to the I/O server, a slot is reused once its send completed
+    float *snapshotSlots = NULL;
+    MPI_Request snapshotRequests[IO_BUFFER_SLOTS];
+    for(int slot = 0; slot < IO_BUFFER_SLOTS; slot++)
+    {
+        snapshotRequests[slot] = MPI_REQUEST_NULL;
+    }
+    if(ioServers.nServers > 0)
+    {
+        snapshotSlots = (float *) malloc(IO_BUFFER_SLOTS * tileWidth * tileHeight * sizeof(float));
+    }
+
+    //Hybrid MPI+OpenMP mode, every rank runs a team over its tile
+    const bool hybrid = (parameters.nThreads > 1);
+
+    //Persistent point-to-point halo exchange, set up once for both ping-pong tiles
+    //(newTile of an even iteration is tiles[0], of an odd one tiles[1]),
+    //receives are the first nHaloRequests requests of the parity, sends the rest
+    const bool pointToPoint = (extParameters.haloExchange == HALO_P2P) || sharedMemory;
+    float *tiles[2] = {newTile, oldTile};
+    MPI_Request haloRequests[2][8];
+    int nHaloRequests = 0;
+
+    //Neighbours on the same node only announce their strips are ready (empty messages)
+    //and the halos are copied from their tiles: {left, right, top, bottom}
+    int haloCounts[4] = {1, 1, 1, 1};
+    if(sharedMemory)
+    {
+        for(int n = 0; n < 4; n++)
+            haloCounts[n] = (sharedTiles.neighbourTiles[n] != NULL) ? 0 : 1;
+    }
+
+    //Packed left and right halos of both tiles: {received from left, from right, sent to right, to left},
+    //half precision halos go through them as well
+    const bool halfHalos = extParameters.halfHalos;
+    const bool packColumns = (extParameters.packColumns || halfHalos) && (cols > 1);
+    const int nPackBlocks = (tileHeight + PACK_BLOCK_ROWS - 1) / PACK_BLOCK_ROWS;
+    float *columnBuffers[2][4];
+    for(int parity = 0; parity < 2; parity++)
+        for(int b = 0; b < 4; b++)
+            columnBuffers[parity][b] = packColumns ? (float *) _mm_malloc(2 * tileHeight * sizeof(float), DATA_ALIGNMENT)
+                                                   : NULL;
+
+    //Half precision halos of both tiles: the columns as above, then {received from top, from bottom,
+    //sent to bottom, to top}, rows are as wide as the vertical halo type
+    const int rowHaloWidth = strips ? tileWidth + HALOZONE : tileWidth;
+    uint16_t *halfBuffers[2][8];
+    for(int parity = 0; parity < 2; parity++)
+        for(int b = 0; b < 8; b++)
+            halfBuffers[parity][b] = halfHalos ? (uint16_t *) _mm_malloc(2 * ((b < 4) ? tileHeight : rowHaloWidth) * sizeof(uint16_t),
+                                                                         DATA_ALIGNMENT)
+                                               : NULL;
+
+    if(pointToPoint)
+    {
+        for(int parity = 0; parity < 2; parity++)
         {
-            MPI_Irecv(&(newTile[2 * (tileWidth + HALOZONE) + tileWidth + 2]), 1, horizontalHaloType, (iIndex * cols) + (jIndex + 1), TAG_RIGHT, MPI_COMM_WORLD, &requests[counter]);
-            counter++;
+            float *tile = tiles[parity];
+
+            //Columns of the tile or the packed buffers
+            void *leftRecv  = packColumns ? (void *) columnBuffers[parity][0] : (void *) &(tile[2 * (tileWidth + HALOZONE) + 0]);
+            void *rightRecv = packColumns ? (void *) columnBuffers[parity][1] : (void *) &(tile[2 * (tileWidth + HALOZONE) + tileWidth + 2]);
+            void *rightSend = packColumns ? (void *) columnBuffers[parity][2] : (void *) &(tile[2 * (tileWidth + HALOZONE) + tileWidth]);
+            void *leftSend  = packColumns ? (void *) columnBuffers[parity][3] : (void *) &(tile[2 * (tileWidth + HALOZONE) + 2]);
+            const int columnCount = packColumns ? 2 * tileHeight : 1;
+            MPI_Datatype columnType = packColumns ? MPI_FLOAT : horizontalHaloType;
+
+            //Rows of the tile or the half precision buffers
+            void *topRecv    = &(tile[0 * (tileWidth + HALOZONE) + rowHaloStart]);
+            void *bottomRecv = &(tile[(tileHeight + 2) * (tileWidth + HALOZONE) + rowHaloStart]);
+            void *bottomSend = &(tile[(tileHeight) * (tileWidth + HALOZONE) + rowHaloStart]);
+            void *topSend    = &(tile[2 * (tileWidth + HALOZONE) + rowHaloStart]);
+            int rowCount = 1;
+            MPI_Datatype rowType = verticalHaloType;
+            if(halfHalos)
+            {
+                if(packColumns)
+                {
+                    leftRecv  = halfBuffers[parity][0];
+                    rightRecv = halfBuffers[parity][1];
+                    rightSend = halfBuffers[parity][2];
+                    leftSend  = halfBuffers[parity][3];
+                    columnType = MPI_UINT16_T;
+                }
+                topRecv    = halfBuffers[parity][4];
+                bottomRecv = halfBuffers[parity][5];
+                bottomSend = halfBuffers[parity][6];
+                topSend    = halfBuffers[parity][7];
+                rowCount = 2 * rowHaloWidth;
+                rowType = MPI_UINT16_T;
+            }
+
+            MPI_Request *recvRequests = haloRequests[parity];
+            int nRecv = 0;
+            //Left halozone
+            if(jIndex != 0)
+                MPI_Recv_init(leftRecv, haloCounts[0] * columnCount, columnType, decomposition.leftRank, TAG_LEFT, cartComm, &recvRequests[nRecv++]);
+            //Right halozone
+            if(jIndex != cols - 1)
+                MPI_Recv_init(rightRecv, haloCounts[1] * columnCount, columnType, decomposition.rightRank, TAG_RIGHT, cartComm, &recvRequests[nRecv++]);
+            //Top halozone
+            if(iIndex != 0)
+                MPI_Recv_init(topRecv, haloCounts[2] * rowCount, rowType, decomposition.topRank, TAG_TOP, cartComm, &recvRequests[nRecv++]);
+            //Bottom halozone
+            if(iIndex != rows - 1)
+                MPI_Recv_init(bottomRecv, haloCounts[3] * rowCount, rowType, decomposition.bottomRank, TAG_BOTTOM, cartComm, &recvRequests[nRecv++]);
+
+            MPI_Request *sendRequests = &haloRequests[parity][nRecv];
+            int nSend = 0;
+            //Left halozone
+            if(jIndex != cols - 1)
+                MPI_Send_init(rightSend, haloCounts[1] * columnCount, columnType, decomposition.rightRank, TAG_LEFT, cartComm, &sendRequests[nSend++]);
+            //Right halozone
+            if(jIndex != 0)
+                MPI_Send_init(leftSend, haloCounts[0] * columnCount, columnType, decomposition.leftRank, TAG_RIGHT, cartComm, &sendRequests[nSend++]);
+            //Top halozone
+            if(iIndex != rows - 1)
+                MPI_Send_init(bottomSend, haloCounts[3] * rowCount, rowType, decomposition.bottomRank, TAG_TOP, cartComm, &sendRequests[nSend++]);
+            //Bottom halozone
+            if(iIndex != 0)
+                MPI_Send_init(topSend, haloCounts[2] * rowCount, rowType, decomposition.topRank, TAG_BOTTOM, cartComm, &sendRequests[nSend++]);
+
+            nHaloRequests = nRecv;
         }
-        //Top halozone
-        if(iIndex != 0)
+    }
+
+    //One-sided halo exchange, every tile in its window, halos of newTile exposed during the iteration
+    const bool remoteMemoryAccess = (extParameters.haloExchange == HALO_RMA);
+    TRmaHaloExchange rmaHaloExchange;
+    if(remoteMemoryAccess)
+    {
+        CreateRmaHaloExchange(rmaHaloExchange, decomposition, dimension, tiles);
+    }
+
+    //newTile of the iteration is tiles[iteration & 1], both tiles hold the same data yet
+    if(startIteration & 1)
+    {
+        swap(newTile, oldTile);
+    }
+    //Progress already printed before the checkpoint
+    while((float) startIteration > (parameters.nIterations - 2) / 10.0f * (float) printCounter)
+    {
+        ++printCounter;
+    }
+
+    int iteration;
+    for (iteration = startIteration; iteration < parameters.nIterations - 1; iteration++) //todo parameters.nIterations
+    { //todo start
+        const int parity = iteration & 1;
+
+        //Halos are exchanged in the last iteration of every haloDepth ones, the computed
+        //region reaches further into the halo zones the sooner the next iteration is
+        const int haloStep = iteration % haloDepth;
+        const bool exchangeStep = (haloStep == haloDepth - 1);
+        const int extension = 2 * (haloDepth - 1 - haloStep);
+
+        const int iStart = (iIndex == 0)? haloWidth + 2 : haloWidth - extension;
+        const int iEnd = (iIndex == rows - 1)? haloWidth + tileHeight - 2 : haloWidth + tileHeight + extension;
+        const int jStart = (jIndex == 0)? haloWidth + 2 : haloWidth - extension;
+        const int jEnd = (jIndex == cols - 1)? haloWidth + tileWidth - 2 : haloWidth + tileWidth + extension;
+
+        if(pointToPoint)
         {
-            MPI_Irecv(&(newTile[0 * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex - 1) * cols) + (jIndex), TAG_TOP, MPI_COMM_WORLD, &requests[counter]);
-            counter++;
+            MPI_Startall(nHaloRequests, haloRequests[parity]);
         }
-        //Bottom halozone
-        if(iIndex != rows - 1)
+        if(remoteMemoryAccess)
         {
-            MPI_Irecv(&(newTile[(tileHeight + 2) * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex + 1) * cols) + (jIndex), TAG_BOTTOM, MPI_COMM_WORLD, &requests[counter]);
-            counter++;
+            MPI_Win_post(rmaHaloExchange.neighbourGroup, 0, rmaHaloExchange.windows[parity]);
         }
         //MPI_Waitall(counter, requests, statuses);
 
@@ -613,131 +1257,316 @@ void ParallelHeatDistribution(float                     *parResult,
                              domainParamsTile,
                              (int*)domainMapTile,
                              i, j,
-                             (tileWidth + HALOZONE),
+                             rowSize,
                              parameters.airFlowRate,
                              materialProperties.coolerTemp);
             }
         }*/
 
-        //Left halozone
-        if(jIndex != cols - 1)
+        //Requests of this iteration, only the master thread calls MPI (MPI_THREAD_FUNNELED)
+        MPI_Request *iterationRequests = pointToPoint ? haloRequests[parity] : requests;
+        const int nIterationRequests = pointToPoint ? 2 * nHaloRequests : (remoteMemoryAccess ? 0 : 1);
+
+        //Ends of the boundary strips, of the posting, and the start and the end of the wait,
+        //haloDone is set by the master thread once it sees the exchange completed
+        const double computeStart = MPI_Wtime();
+        double boundaryEnd = computeStart, postEnd = computeStart;
+        double waitStart = computeStart, waitEnd = computeStart, haloArrival = computeStart;
+        bool haloDone = false;
+        const MPI_Win exposureWindow = remoteMemoryAccess ? rmaHaloExchange.windows[parity] : MPI_WIN_NULL;
+
+        //Hybrid mode: the team computes the tile, halos of oldTile arrived in the previous iteration
+        #pragma omp parallel if(hybrid) num_threads(parameters.nThreads)
         {
-            for (int i = iStart; i < iEnd; i++)
+            if(!exchangeStep)
             {
-                for (int j = tileWidth; j < tileWidth + 2; j++)
+                //Tile and the part of the halos valid for the next iteration, no messages
+                #pragma omp for
+                for (int i = iStart; i < iEnd; i++)
                 {
-                    ComputePoint(oldTile,
-                                 newTile,
-                                 domainParamsTile,
-                                 domainMapTile,
-                                 i, j,
-                                 (tileWidth + HALOZONE),
-                                 parameters.airFlowRate,
-                                 materialProperties.coolerTemp);
+                    for (int j = jStart; j < jEnd; j++)
+                    {
+                        ComputePoint(oldTile,
+                                     newTile,
+                                     domainParamsTile,
+                                     domainMapTile,
+                                     i, j,
+                                     rowSize,
+                                     parameters.airFlowRate,
+                                     materialProperties.coolerTemp);
+                    }
                 }
             }
-
-        }
-        //Right halozone
-        if(jIndex != 0)
-        {
-            for (int i = iStart; i < iEnd; i++)
+            else
             {
-                for (int j = 2; j < 4; j++)
+                //Left halozone
+                if(jIndex != cols - 1)
                 {
-                    ComputePoint(oldTile,
-                                 newTile,
-                                 domainParamsTile,
-                                 domainMapTile,
-                                 i, j,
-                                 (tileWidth + HALOZONE),
-                                 parameters.airFlowRate,
-                                 materialProperties.coolerTemp);
+                    #pragma omp for
+                    for (int i = iStart; i < iEnd; i++)
+                    {
+                        for (int j = tileWidth; j < tileWidth + haloWidth; j++)
+                        {
+                            ComputePoint(oldTile,
+                                         newTile,
+                                         domainParamsTile,
+                                         domainMapTile,
+                                         i, j,
+                                         rowSize,
+                                         parameters.airFlowRate,
+                                         materialProperties.coolerTemp);
+                        }
+                    }
+
                 }
-            }
+                //Right halozone
+                if(jIndex != 0)
+                {
+                    #pragma omp for
+                    for (int i = iStart; i < iEnd; i++)
+                    {
+                        for (int j = haloWidth; j < 2 * haloWidth; j++)
+                        {
+                            ComputePoint(oldTile,
+                                         newTile,
+                                         domainParamsTile,
+                                         domainMapTile,
+                                         i, j,
+                                         rowSize,
+                                         parameters.airFlowRate,
+                                         materialProperties.coolerTemp);
+                        }
+                    }
 
-        }
-        //Top halozone
-        if(iIndex != rows - 1)
-        {
-            for (int i = tileHeight; i < tileHeight + 2; ++i)
-            {
-                for (int j = jStart; j < jEnd; ++j)
+                }
+                //Top halozone
+                if(iIndex != rows - 1)
                 {
-                    ComputePoint(oldTile,
-                                 newTile,
-                                 domainParamsTile,
-                                 domainMapTile,
-                                 i, j,
-                                 (tileWidth + HALOZONE),
-                                 parameters.airFlowRate,
-                                 materialProperties.coolerTemp);
+                    #pragma omp for
+                    for (int j = jStart; j < jEnd; ++j)
+                    {
+                        for (int i = tileHeight; i < tileHeight + haloWidth; ++i)
+                        {
+                            ComputePoint(oldTile,
+                                         newTile,
+                                         domainParamsTile,
+                                         domainMapTile,
+                                         i, j,
+                                         rowSize,
+                                         parameters.airFlowRate,
+                                         materialProperties.coolerTemp);
+                        }
+
+                    }
                 }
+                //Bottom halozone
+                if(iIndex != 0)
+                {
+                    #pragma omp for
+                    for (int j = jStart; j < jEnd; j++)
+                    {
+                        for (int i = haloWidth; i < 2 * haloWidth; i++)
+                        {
+                            ComputePoint(oldTile,
+                                         newTile,
+                                         domainParamsTile,
+                                         domainMapTile,
+                                         i, j,
+                                         rowSize,
+                                         parameters.airFlowRate,
+                                         materialProperties.coolerTemp);
+                        }
 
-            }
-        }
-        //Bottom halozone
-        if(iIndex != 0)
-        {
-            for (int i = 2; i < 4; i++)
-            {
-                for (int j = jStart; j < jEnd; j++)
+                    }
+                }
+
+                //Boundary columns into the send buffers, the team packs blocks of rows
+                if(packColumns)
                 {
-                    ComputePoint(oldTile,
-                                 newTile,
-                                 domainParamsTile,
-                                 domainMapTile,
-                                 i, j,
-                                 (tileWidth + HALOZONE),
-                                 parameters.airFlowRate,
-                                 materialProperties.coolerTemp);
+                    #pragma omp for
+                    for(int block = 0; block < nPackBlocks; block++)
+                    {
+                        const size_t firstRow = block * PACK_BLOCK_ROWS;
+                        const size_t nRows = min<size_t>(PACK_BLOCK_ROWS, tileHeight - firstRow);
+                        if(jIndex != cols - 1 && haloCounts[1])
+                        {
+                            PackColumns(&newTile[2 * rowSize + tileWidth], columnBuffers[parity][2], rowSize, firstRow, nRows);
+                            if(halfHalos)
+                                ConvertToHalf(&columnBuffers[parity][2][2 * firstRow], &halfBuffers[parity][2][2 * firstRow], 2 * nRows);
+                        }
+                        if(jIndex != 0 && haloCounts[0])
+                        {
+                            PackColumns(&newTile[2 * rowSize + 2], columnBuffers[parity][3], rowSize, firstRow, nRows);
+                            if(halfHalos)
+                                ConvertToHalf(&columnBuffers[parity][3][2 * firstRow], &halfBuffers[parity][3][2 * firstRow], 2 * nRows);
+                        }
+                    }
                 }
 
-            }
-        }
+                //Boundary rows into the half precision buffers, one row per thread
+                if(halfHalos)
+                {
+                    #pragma omp for
+                    for(int row = 0; row < 4; row++)
+                    {
+                        //Rows tileHeight, tileHeight + 1 to the bottom, 2, 3 to the top
+                        if(row < 2 && iIndex != rows - 1 && haloCounts[3])
+                            ConvertToHalf(&newTile[(tileHeight + row) * rowSize + rowHaloStart],
+                                          &halfBuffers[parity][6][row * rowHaloWidth], rowHaloWidth);
+                        if(row >= 2 && iIndex != 0 && haloCounts[2])
+                            ConvertToHalf(&newTile[row * rowSize + rowHaloStart],
+                                          &halfBuffers[parity][7][(row - 2) * rowHaloWidth], rowHaloWidth);
+                    }
+                }
 
-        //Left halozone
-        if(jIndex != cols - 1)
-        {
-            MPI_Isend(&(newTile[2 * (tileWidth + HALOZONE) + tileWidth]), 1, horizontalHaloType, (iIndex * cols) + (jIndex + 1), TAG_LEFT, MPI_COMM_WORLD, &requests[counter]);
-            counter++;
-        }
-        //Right halozone
-        if(jIndex != 0)
-        {
-            MPI_Isend(&(newTile[2 * (tileWidth + HALOZONE) + 2]), 1, horizontalHaloType, (iIndex * cols) + (jIndex - 1), TAG_RIGHT, MPI_COMM_WORLD, &requests[counter]);
-            counter++;
-        }
-        //Top halozone
-        if(iIndex != rows - 1)
-        {
-            MPI_Isend(&(newTile[(tileHeight) * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex + 1) * cols) + (jIndex), TAG_TOP, MPI_COMM_WORLD, &requests[counter]);
-            counter++;
-        }
-        //Bottom halozone
-        if(iIndex != 0)
-        {
-            MPI_Isend(&(newTile[2 * (tileWidth + HALOZONE) + 2]), 1, verticalHaloType, ((iIndex - 1) * cols) + (jIndex), TAG_BOTTOM, MPI_COMM_WORLD, &requests[counter]);
-            counter++;
-        }
-        //MPI_Waitall(counter2, requests2, statuses2);
+                //Boundary strips are done (barrier of the loops above), send them
+                #pragma omp master
+                {
+                    boundaryEnd = MPI_Wtime();
+                    if(pointToPoint)
+                    {
+                        //Strips written by the team are visible to the node before they are announced
+                        if(sharedMemory) MPI_Win_sync(sharedTiles.window);
+                        MPI_Startall(nHaloRequests, &haloRequests[parity][nHaloRequests]);
+                    }
+                    else if(remoteMemoryAccess)
+                    {
+                        StartRmaHaloExchange(rmaHaloExchange, newTile, parity);
+                    }
+                    else
+                    {
+                        //Whole pattern in one neighbourhood collective
+                        StartHaloExchange(floatHaloExchange, newTile, haloSendBuffers[0].data(), &requests[0]);
+                    }
+                    postEnd = MPI_Wtime();
+                }
 
-        for (int i = 4 ; i < tileHeight; i++)
-        {
-            for (int j = 4; j < tileWidth; j++)
-            {
-                ComputePoint(oldTile,
-                             newTile,
-                             domainParamsTile,
-                             domainMapTile,
-                             i, j,
-                             (tileWidth + HALOZONE),
-                             parameters.airFlowRate,
-                             materialProperties.coolerTemp);
+                //Progress thread: the master only polls the exchange while the team starts
+                //the interior, then joins the chunks left
+                #pragma omp master
+                {
+                    if(progressThread)
+                    {
+                        //Neighbours polling their exposure epochs wait for the end of this access epoch
+                        if(remoteMemoryAccess) MPI_Win_complete(rmaHaloExchange.windows[parity]);
+
+                        while(!haloDone)
+                        {
+                            haloDone = TestHaloExchange(nIterationRequests, iterationRequests, exposureWindow);
+                        }
+                        haloArrival = MPI_Wtime();
+                    }
+                }
+
+                //Interior in chunks of rows, the master tests the exchange after every chunk it computes
+                const int chunk = extParameters.progressChunk;
+                #pragma omp for schedule(dynamic, 1) nowait
+                for (int iChunk = iInStart; iChunk < iInEnd; iChunk += chunk)
+                {
+                    for (int i = iChunk; i < min(iChunk + chunk, iInEnd); i++)
+                    {
+                        for (int j = jInStart; j < jInEnd; j++)
+                        {
+                            ComputePoint(oldTile,
+                                         newTile,
+                                         domainParamsTile,
+                                         domainMapTile,
+                                         i, j,
+                                         rowSize,
+                                         parameters.airFlowRate,
+                                         materialProperties.coolerTemp);
+                        }
+                    }
+
+                    if((omp_get_thread_num() == 0) && !haloDone)
+                    {
+                        haloDone = TestHaloExchange(nIterationRequests, iterationRequests, exposureWindow);
+                        if(haloDone) haloArrival = MPI_Wtime();
+                    }
+                }
+
+                #pragma omp master
+                {
+                    waitStart = MPI_Wtime();
+                    if(!remoteMemoryAccess)
+                    {
+                        MPI_Waitall(nIterationRequests, iterationRequests, MPI_STATUSES_IGNORE);
+                    }
+
+                    //All neighbours announced their strips, read them directly (halos only, the team
+                    //still computes the interior)
+                    if(sharedMemory)
+                    {
+                        MPI_Win_sync(sharedTiles.window);
+                        CopySharedHalos(sharedTiles, decomposition, newTile, parity);
+                    }
+
+                    //Own puts done, then the puts of all neighbours (unless a test completed them)
+                    if(remoteMemoryAccess)
+                    {
+                        if(!progressThread) MPI_Win_complete(rmaHaloExchange.windows[parity]);
+                        if(!haloDone) MPI_Win_wait(rmaHaloExchange.windows[parity]);
+                    }
+                    waitEnd = MPI_Wtime();
+                    if(!haloDone) haloArrival = waitEnd;
+                }
+
+                //Received columns into the halos once the master has them
+                if(packColumns || halfHalos)
+                {
+                    #pragma omp barrier
+                }
+                if(packColumns)
+                {
+                    #pragma omp for nowait
+                    for(int block = 0; block < nPackBlocks; block++)
+                    {
+                        const size_t firstRow = block * PACK_BLOCK_ROWS;
+                        const size_t nRows = min<size_t>(PACK_BLOCK_ROWS, tileHeight - firstRow);
+                        if(jIndex != 0 && haloCounts[0])
+                        {
+                            if(halfHalos)
+                                ConvertFromHalf(&halfBuffers[parity][0][2 * firstRow], &columnBuffers[parity][0][2 * firstRow], 2 * nRows);
+                            UnpackColumns(columnBuffers[parity][0], &newTile[2 * rowSize + 0], rowSize, firstRow, nRows);
+                        }
+                        if(jIndex != cols - 1 && haloCounts[1])
+                        {
+                            if(halfHalos)
+                                ConvertFromHalf(&halfBuffers[parity][1][2 * firstRow], &columnBuffers[parity][1][2 * firstRow], 2 * nRows);
+                            UnpackColumns(columnBuffers[parity][1], &newTile[2 * rowSize + tileWidth + 2], rowSize, firstRow, nRows);
+                        }
+                    }
+                }
+
+                //Received rows into the halos, the implicit barrier ends the exchange
+                if(halfHalos)
+                {
+                    #pragma omp for
+                    for(int row = 0; row < 4; row++)
+                    {
+                        //Rows 0, 1 from the top, tileHeight + 2, tileHeight + 3 from the bottom
+                        if(row < 2 && iIndex != 0 && haloCounts[2])
+                            ConvertFromHalf(&halfBuffers[parity][4][row * rowHaloWidth],
+                                            &newTile[row * rowSize + rowHaloStart], rowHaloWidth);
+                        if(row >= 2 && iIndex != rows - 1 && haloCounts[3])
+                            ConvertFromHalf(&halfBuffers[parity][5][(row - 2) * rowHaloWidth],
+                                            &newTile[(tileHeight + row) * rowSize + rowHaloStart], rowHaloWidth);
+                    }
+                }
+                else if(packColumns)
+                {
+                    #pragma omp barrier
+                }
             }
-        }
+        } // omp parallel
 
-        MPI_Waitall(counter, requests, statuses);
+        //The interior includes the wait of the team at the end of the region, the exchange
+        //was in flight from the posting to the arrival of all halos, only the wait was exposed
+        phaseTimes[PHASE_BOUNDARY]  += boundaryEnd - computeStart;
+        phaseTimes[PHASE_HALO_WAIT] += (postEnd - boundaryEnd) + (waitEnd - waitStart);
+        phaseTimes[PHASE_INTERIOR]  += (MPI_Wtime() - postEnd) - (waitEnd - waitStart);
+        haloInFlight += haloArrival - postEnd;
+        haloExposed  += waitEnd - waitStart;
 
 
         /*for(int j = 0; j < size; j++)
@@ -758,24 +1587,30 @@ void ParallelHeatDistribution(float                     *parResult,
         }*/
 
         /************** Middle column computation ************/
-        if(rank == 0)
-        {
-            middleColAvgTemp = 0.0f;
-        }
+        //The average is needed only by the progress print and the final output,
+        //the reduction is completed there (every rank keeps printCounter in step)
+        const bool printProgress = ((float) (iteration) >= (parameters.nIterations - 2) / 10.0f * (float) printCounter) &&
+                                   !parameters.batchMode;
+        const bool lastIteration = (iteration == parameters.nIterations - 2);
 
-        tileMiddleColAvgTemp = 0.0f;
-        if((jIndex == cols / 2) && jIndex == cols / 2)
+        if((printProgress || lastIteration) && (middleColComm != MPI_COMM_NULL))
         {
-            for(int i = 2; i < tileHeight + 2; i++)
+            phaseStart = MPI_Wtime();
+
+            //The send buffer of the previous reduction is reused
+            MPI_Wait(&middleColRequest, MPI_STATUS_IGNORE);
+
+            tileMiddleColAvgTemp = 0.0f;
+            if(middleColTile)
             {
-                tileMiddleColAvgTemp += newTile[i * (tileWidth + HALOZONE) + ((size > 2) ? 2 : (2 + tileWidth/2))];
+                for(int i = haloWidth; i < tileHeight + haloWidth; i++)
+                {
+                    tileMiddleColAvgTemp += newTile[i * rowSize + haloWidth + (dimension / 2 - decomposition.tilePosX)];
+                }
             }
-        }
-        MPI_Reduce(&tileMiddleColAvgTemp, &middleColAvgTemp, 1, MPI_FLOAT, MPI_SUM, 0, MPI_COMM_WORLD);
+            MPI_Ireduce(&tileMiddleColAvgTemp, &middleColSum, 1, MPI_FLOAT, MPI_SUM, 0, middleColComm, &middleColRequest);
 
-        if (rank == 0)
-        {
-            middleColAvgTemp /= dimension;
+            phaseTimes[PHASE_REDUCTION] += MPI_Wtime() - phaseStart;
         }
         /****************************************************/
 
@@ -783,20 +1618,35 @@ void ParallelHeatDistribution(float                     *parResult,
         /**************************** Write output *************************/
         if (iteration % parameters.diskWriteIntensity == 0)
         {
-            if(!parameters.useParallelIO)
+            if(ioServers.nServers > 0)
+            {
+                //Dedicated I/O servers, the computation goes on while the snapshot is written
+                if(outputFileName != "")
+                {
+                    phaseStart = MPI_Wtime();
+                    SendSnapshotTile(newTile, decomposition, iteration / parameters.diskWriteIntensity,
+                                     snapshotSlots, snapshotRequests);
+                    phaseTimes[PHASE_WRITE] += MPI_Wtime() - phaseStart;
+                }
+            }
+            else if(!parameters.useParallelIO)
             {
                 // Serial I/O
                 // store data to root
                 // *** Zde posbirejte data do 0. procesu, ktery vytvarel vystupni soubor ***
-                MPI_Gatherv(&(newTile[2 * (tileWidth + HALOZONE) + 2]), 1,  tileType, dataPtr, sendcounts, displs, haloTileType, 0, MPI_COMM_WORLD); //todo really old?
+                phaseStart = MPI_Wtime();
+                GatherTiles(newTile, dataPtr, floatTileTypes, decomposition);
+                phaseTimes[PHASE_GATHER] += MPI_Wtime() - phaseStart;
                 // store time step in the output file if necessary
                 if (rank == 0 && file_id != H5I_INVALID_HID)
                 {
+                    phaseStart = MPI_Wtime();
                     StoreDataIntoFile(file_id,
                                       parResult,
                                       materialProperties.edgeSize,
                                       iteration / parameters.diskWriteIntensity,
                                       iteration);
+                    phaseTimes[PHASE_WRITE] += MPI_Wtime() - phaseStart;
                 }
             }
             else
@@ -804,26 +1654,44 @@ void ParallelHeatDistribution(float                     *parResult,
                 // Parallel I/O
                 if(file_id != H5I_INVALID_HID)
                 {
+                    phaseStart = MPI_Wtime();
                     StoreDataIntoFileParallel(file_id,
                                               newTile,
                                               materialProperties.edgeSize,
-                                              tileWidth + 4, tileHeight + 4,
-                                              (tileWidth) * jIndex, (tileHeight) * iIndex,
-                                              iteration / parameters.diskWriteIntensity, iteration);
+                                              rowSize, tileHeight + 2 * haloWidth,
+                                              haloWidth,
+                                              decomposition.tilePosX, decomposition.tilePosY,
+                                              iteration / parameters.diskWriteIntensity, iteration,
+                                              outputLayout);
+                    phaseTimes[PHASE_WRITE] += MPI_Wtime() - phaseStart;
                 }
             }
         }
         /******************************************************************/
 
+        /**************************** Checkpoint ***************************/
+        if((extParameters.checkpointFileName != "") && ((iteration + 1) % extParameters.checkpointInterval == 0) &&
+           !lastIteration)
+        {
+            phaseStart = MPI_Wtime();
+            StoreCheckpoint(extParameters.checkpointFileName, newTile, decomposition, dimension, iteration + 1);
+            phaseTimes[PHASE_WRITE] += MPI_Wtime() - phaseStart;
+        }
+        /******************************************************************/
+
         swap(newTile, oldTile);
 
-        if(rank == 0)
+        if(printProgress)
         {
-            if (((float) (iteration) >= (parameters.nIterations - 2) / 10.0f * (float) printCounter) && !parameters.batchMode)
+            if(rank == 0)
             {
+                phaseStart = MPI_Wtime();
+                MPI_Wait(&middleColRequest, MPI_STATUS_IGNORE);
+                phaseTimes[PHASE_REDUCTION] += MPI_Wtime() - phaseStart;
+                middleColAvgTemp = middleColSum / dimension;
                 printf("Progress %ld%% (Average Temperature %.2f degrees)\n", (iteration + 1) * 100L / (parameters.nIterations - 1), middleColAvgTemp);
-                ++printCounter;
             }
+            ++printCounter;
         }
         /*if(rank == 0)
         {
@@ -842,6 +1710,19 @@ void ParallelHeatDistribution(float                     *parResult,
 
     /****************************************************/
 
+    //Average of the last iteration
+    if(middleColComm != MPI_COMM_NULL)
+    {
+        phaseStart = MPI_Wtime();
+        MPI_Wait(&middleColRequest, MPI_STATUS_IGNORE);
+        phaseTimes[PHASE_REDUCTION] += MPI_Wtime() - phaseStart;
+        MPI_Comm_free(&middleColComm);
+    }
+    if(rank == 0)
+    {
+        middleColAvgTemp = middleColSum / dimension;
+    }
+
     double totalTime;
     if(rank == 0)
     {
@@ -850,18 +1731,28 @@ void ParallelHeatDistribution(float                     *parResult,
         if (!parameters.batchMode)
             printf("\nExecution time of parallel version %.5f\n", totalTime);
         else
-            printf("%s;%s;%f;%e;%e\n", outputFileName.c_str(), "seq",
+            printf("%s;%s;%f;%e;%e\n", outputFileName.c_str(), "par",
                    middleColAvgTemp, totalTime,
-                   totalTime / parameters.nIterations - 1);
+                   totalTime / (parameters.nIterations - 1));
     }
 
     // close the output file
+    phaseStart = MPI_Wtime();
     if (file_id != H5I_INVALID_HID) H5Fclose(file_id);
 
-    MPI_Gatherv(&(oldTile[2 * (tileWidth + HALOZONE) + 2]), 1, tileType, dataPtr, sendcounts, displs, haloTileType, 0, MPI_COMM_WORLD);
-    if(rank == 0)
+    // the last snapshots have to reach the I/O servers
+    MPI_Waitall(IO_BUFFER_SLOTS, snapshotRequests, MPI_STATUSES_IGNORE);
+    phaseTimes[PHASE_WRITE] += MPI_Wtime() - phaseStart;
+    free(snapshotSlots);
+
+    phaseStart = MPI_Wtime();
+    GatherTiles(oldTile, dataPtr, floatTileTypes, decomposition);
+    phaseTimes[PHASE_GATHER] += MPI_Wtime() - phaseStart;
+
+    ReportPhaseTimes(phaseTimes, haloInFlight, haloExposed, cartComm, !parameters.batchMode, extParameters.timingFileName);
+    /*if(rank == 0)
     {
-        /*printf("Global pararel array is:\n");
+        printf("Global pararel array is:\n");
         for (int y = 0; y < materialProperties.edgeSize; y++)
         {
             for (int x = 0; x < materialProperties.edgeSize; x++)
@@ -869,11 +1760,45 @@ void ParallelHeatDistribution(float                     *parResult,
                 printf("%f ", parResult[y * materialProperties.edgeSize + x]);
             }
             printf("\n");
-        }*/
+        }
+    }*/
 
-        _mm_free(domainParamsTemp);
-        _mm_free(domainMapTemp);
+    FreeTileTypes(floatTileTypes);
+    FreeTileTypes(intTileTypes);
+    FreeHaloExchange(floatHaloExchange);
+    FreeHaloExchange(intHaloExchange);
+    if(pointToPoint)
+    {
+        for(int parity = 0; parity < 2; parity++)
+            for(int r = 0; r < 2 * nHaloRequests; r++)
+                MPI_Request_free(&haloRequests[parity][r]);
+    }
+    if(remoteMemoryAccess)
+    {
+        FreeRmaHaloExchange(rmaHaloExchange);
+    }
+    for(int parity = 0; parity < 2; parity++)
+        for(int b = 0; b < 4; b++)
+            _mm_free(columnBuffers[parity][b]);
+    for(int parity = 0; parity < 2; parity++)
+        for(int b = 0; b < 8; b++)
+            _mm_free(halfBuffers[parity][b]);
+    MPI_Type_free(&horizontalHaloType);
+    MPI_Type_free(&verticalHaloType);
+    MPI_Comm_free(&decomposition.neighbourComm);
+    MPI_Comm_free(&decomposition.cartComm);
+
+    if(sharedMemory)
+    {
+        FreeSharedTiles(sharedTiles);
+    }
+    else
+    {
+        free(newTile);
+        free(oldTile);
     }
+    free(domainParamsTile);
+    free(domainMapTile);
 } // end of ParallelHeatDistribution
 //------------------------------------------------------------------------------
 
@@ -951,25 +1876,29 @@ void StoreDataIntoFile(hid_t         h5fileId,
  * @param [in] edgeSize   - size of the domain
  * @param [in] tileWidth  - width of the tile
  * @param [in] tileHeight - height of the tile
+ * @param [in] haloWidth  - width of the halo zones around the tile
  * @param [in] tilePosX   - position of the tile in the grid (X-dir)
  * @param [in] tilePosY   - position of the tile in the grid (Y-dir)
  * @param [in] snapshotId - snapshot id
  * @param [in] iteration  - id of iteration
+ * @param [in] layout     - chunks of the dataset and the kind of write
  */
 void StoreDataIntoFileParallel(hid_t h5fileId,
                                const float *data,
                                const size_t edgeSize,
                                const size_t tileWidth, const size_t tileHeight,
+                               const size_t haloWidth,
                                const size_t tilePosX, const size_t tilePosY,
                                const size_t snapshotId,
-                               const size_t iteration)
+                               const size_t iteration,
+                               const TOutputLayout &layout)
 {
     hid_t dataset_id, dataspace_id, group_id, attribute_id, memspace_id;
     const hsize_t dims[2] = { edgeSize, edgeSize };
     const hsize_t offset[2] = { tilePosY, tilePosX };
     const hsize_t tile_dims[2] = { tileHeight, tileWidth };
-    const hsize_t core_dims[2] = { tileHeight - 4, tileWidth - 4 };
-    const hsize_t core_offset[2] = { 2, 2 };
+    const hsize_t core_dims[2] = { tileHeight - 2 * haloWidth, tileWidth - 2 * haloWidth };
+    const hsize_t core_offset[2] = { haloWidth, haloWidth };
 
     string groupName = "Timestep_" + to_string((unsigned long)snapshotId);
 
@@ -981,13 +1910,19 @@ void StoreDataIntoFileParallel(hid_t h5fileId,
     // Create the data space in the output file. (2D matrix)
     dataspace_id = H5Screate_simple(2, dims, NULL);
 
+    // chunks of the size of a tile, every rank writes its own chunk
+    hid_t hCreateList = H5Pcreate(H5P_DATASET_CREATE);
+    if (layout.chunkDims[0] > 0 && layout.chunkDims[1] > 0)
+        H5Pset_chunk(hCreateList, 2, layout.chunkDims);
+
     // create a dataset for temperature and write data
     string datasetName = "Temperature";
     dataset_id = H5Dcreate(group_id,
                            datasetName.c_str(),
                            H5T_NATIVE_FLOAT,
                            dataspace_id,
-                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+                           H5P_DEFAULT, hCreateList, H5P_DEFAULT);
+    H5Pclose(hCreateList);
 
     // create the data space in memory representing local tile. (2D matrix)
     memspace_id = H5Screate_simple(2, tile_dims, NULL);
@@ -998,9 +1933,9 @@ void StoreDataIntoFileParallel(hid_t h5fileId,
     // select appropriate block of the output file, where local tile will be placed.
     H5Sselect_hyperslab(dataspace_id, H5S_SELECT_SET, offset, NULL, core_dims, NULL);
 
-    // setup collective write using MPI parallel I/O
+    // setup collective (or independent) write using MPI parallel I/O
     hid_t hPropList = H5Pcreate(H5P_DATASET_XFER);
-    H5Pset_dxpl_mpio(hPropList, H5FD_MPIO_COLLECTIVE);
+    H5Pset_dxpl_mpio(hPropList, layout.collectiveWrite ? H5FD_MPIO_COLLECTIVE : H5FD_MPIO_INDEPENDENT);
 
     H5Dwrite(dataset_id, H5T_NATIVE_FLOAT, memspace_id, dataspace_id, hPropList, data);
 
@@ -1030,85 +1965,2356 @@ void StoreDataIntoFileParallel(hid_t h5fileId,
 //------------------------------------------------------------------------------
 
 /**
- * Main function of the project
- * @param [in] argc
- * @param [in] argv
- * @return
+ * Store time step of the tiles of an I/O server into output file using
+ * parallel HDF5. The group and the dataset are created by all I/O servers,
+ * every server writes its tiles independently.
+ * @param [in] h5fileId   - handle to the output file
+ * @param [in] data       - snapshot buffer of the server (tiles without halo zones)
+ * @param [in] edgeSize   - size of the domain
+ * @param [in] tiles      - tiles of the server
+ * @param [in] snapshotId - snapshot id
+ * @param [in] iteration  - id of iteration
  */
-int main(int argc, char *argv[])
+void StoreTilesIntoFileParallel(hid_t                      h5fileId,
+                                const float               *data,
+                                const size_t               edgeSize,
+                                const vector<TServerTile> &tiles,
+                                const size_t               snapshotId,
+                                const size_t               iteration)
 {
-    int rank, size;
+    hid_t dataset_id, dataspace_id, group_id, attribute_id, memspace_id;
+    const hsize_t dims[2] = { edgeSize, edgeSize };
 
-    ParseCommandline(argc, argv, parameters);
+    string groupName = "Timestep_" + to_string((unsigned long)snapshotId);
 
-    // Initialize MPI
-    MPI_Init(&argc, &argv);
+    // Create a group named "/Timestep_snapshotId" in the file.
+    group_id = H5Gcreate(h5fileId,
+                         groupName.c_str(),
+                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
 
-    // Get MPI rank and size
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    // Create the data space in the output file. (2D matrix)
+    dataspace_id = H5Screate_simple(2, dims, NULL);
+
+    // create a dataset for temperature and write data
+    string datasetName = "Temperature";
+    dataset_id = H5Dcreate(group_id,
+                           datasetName.c_str(),
+                           H5T_NATIVE_FLOAT,
+                           dataspace_id,
+                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
 
+    // servers hold different numbers of tiles, write them independently
+    hid_t hPropList = H5Pcreate(H5P_DATASET_XFER);
+    H5Pset_dxpl_mpio(hPropList, H5FD_MPIO_INDEPENDENT);
 
-    if (rank == 0)
+    for (size_t t = 0; t < tiles.size(); t++)
     {
-        // Create material properties and load from file
-        materialProperties.LoadMaterialData(parameters.materialFileName, true);
-        parameters.edgeSize = materialProperties.edgeSize;
+        const hsize_t offset[2]    = { tiles[t].posY, tiles[t].posX };
+        const hsize_t tile_dims[2] = { tiles[t].height, tiles[t].width };
 
-        parameters.PrintParameters();
+        // the tile is stored contiguously in the snapshot buffer
+        memspace_id = H5Screate_simple(2, tile_dims, NULL);
+
+        // select appropriate block of the output file, where the tile will be placed.
+        H5Sselect_hyperslab(dataspace_id, H5S_SELECT_SET, offset, NULL, tile_dims, NULL);
+
+        H5Dwrite(dataset_id, H5T_NATIVE_FLOAT, memspace_id, dataspace_id, hPropList, data + tiles[t].offset);
+        H5Sclose(memspace_id);
+    }
+
+    // close memory spaces and property list
+    H5Sclose(dataspace_id);
+    H5Pclose(hPropList);
+
+    // write attribute
+    string attributeName = "Time";
+    dataspace_id = H5Screate(H5S_SCALAR);
+    attribute_id = H5Acreate2(group_id, attributeName.c_str(),
+                              H5T_IEEE_F64LE, dataspace_id,
+                              H5P_DEFAULT, H5P_DEFAULT);
+
+    double snapshotTime = double(iteration);
+    H5Awrite(attribute_id, H5T_IEEE_F64LE, &snapshotTime);
+    H5Aclose(attribute_id);
+
+    // close the dataspace
+    H5Sclose(dataspace_id);
+
+    // close the dataset and the group
+    H5Dclose(dataset_id);
+    H5Gclose(group_id);
+} // end of StoreTilesIntoFileParallel
+//------------------------------------------------------------------------------
+
+/**
+ * Create the output file. A restarted simulation keeps the snapshots written
+ * before the checkpoint, so it opens the existing file for writing (the file
+ * is created if it does not exist yet).
+ * @param [in] fileName   - name of the output file
+ * @param [in] accessList - file access property list
+ * @param [in] restart    - is the simulation restarted from a checkpoint?
+ * @return file id
+ */
+hid_t OpenOutputFile(const string &fileName,
+                     hid_t         accessList,
+                     const bool    restart)
+{
+    if (restart)
+    {
+        FILE *file = fopen(fileName.c_str(), "r");
+        if (file != NULL)
+        {
+            fclose(file);
+            return H5Fopen(fileName.c_str(), H5F_ACC_RDWR, accessList);
+        }
+    }
+
+    return H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, accessList);
+} // end of OpenOutputFile
+//------------------------------------------------------------------------------
+
+/**
+ * Remove the snapshots from the given one on. The interrupted run may have
+ * written some of them after the checkpoint, the restarted one writes them
+ * again. Parallel HDF5 needs all processes of the file to call it.
+ * @param [in] h5fileId      - file id
+ * @param [in] firstSnapshot - first snapshot to remove
+ */
+void RemoveSnapshots(hid_t        h5fileId,
+                     const size_t firstSnapshot)
+{
+    // snapshots are numbered without gaps
+    for (size_t snapshotId = firstSnapshot; ; snapshotId++)
+    {
+        const string groupName = "Timestep_" + to_string((unsigned long long) snapshotId);
+        if (H5Lexists(h5fileId, groupName.c_str(), H5P_DEFAULT) <= 0) break;
+
+        H5Ldelete(h5fileId, groupName.c_str(), H5P_DEFAULT);
+    }
+} // end of RemoveSnapshots
+//------------------------------------------------------------------------------
+
+/**
+ * Generate a synthetic material file of any size for benchmarks. A metal
+ * plate (map 1) covers the middle of the domain filled with air (map 0), a
+ * heater starts at the heater temperature in the centre of the plate, the
+ * rest at the cooler temperature. The layout scales with the edge size.
+ * @param [in] fileName - name of the material file
+ * @param [in] edgeSize - size of the domain
+ */
+void GenerateMaterialFile(const string &fileName,
+                          const size_t  edgeSize)
+{
+    const float coolerTemp  = 20.0f;
+    const float heaterTemp  = 100.0f;
+    const float airParam    = 0.05f;
+    const float metalParam  = 1.0f;
+
+    vector<float> initTemp(edgeSize * edgeSize, coolerTemp);
+    vector<float> domainParams(edgeSize * edgeSize, airParam);
+    vector<int>   domainMap(edgeSize * edgeSize, 0);
+
+    const size_t plateStart  = edgeSize / 8;
+    const size_t plateEnd    = edgeSize - edgeSize / 8;
+    const size_t heaterStart = edgeSize / 2 - edgeSize / 16;
+    const size_t heaterEnd   = edgeSize / 2 + edgeSize / 16 + 1;
+
+    for (size_t i = plateStart; i < plateEnd; i++)
+    {
+        for (size_t j = plateStart; j < plateEnd; j++)
+        {
+            domainParams[i * edgeSize + j] = metalParam;
+            domainMap[i * edgeSize + j]    = 1;
+
+            if ((i >= heaterStart) && (i < heaterEnd) && (j >= heaterStart) && (j < heaterEnd))
+                initTemp[i * edgeSize + j] = heaterTemp;
+        }
+    }
+
+    hid_t file_id = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    if (file_id < 0)
+    {
+        fprintf(stderr, "[ERROR]: Cannot create the material file %s.\n", fileName.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    const unsigned long long edge = edgeSize;
+    WriteMaterialDataset(file_id, "/EdgeSize",           H5T_NATIVE_ULLONG, 0, &edge);
+    WriteMaterialDataset(file_id, "/CoolerTemp",         H5T_NATIVE_FLOAT,  0, &coolerTemp);
+    WriteMaterialDataset(file_id, "/HeaterTemp",         H5T_NATIVE_FLOAT,  0, &heaterTemp);
+    WriteMaterialDataset(file_id, "/InitialTemperature", H5T_NATIVE_FLOAT,  edgeSize, initTemp.data());
+    WriteMaterialDataset(file_id, "/DomainParameters",   H5T_NATIVE_FLOAT,  edgeSize, domainParams.data());
+    WriteMaterialDataset(file_id, "/DomainMap",          H5T_NATIVE_INT,    edgeSize, domainMap.data());
+
+    H5Fclose(file_id);
+} // end of GenerateMaterialFile
+//------------------------------------------------------------------------------
+
+/**
+ * Write one dataset of the material file
+ * @param [in] h5fileId    - handle to the material file
+ * @param [in] datasetName - name of the dataset
+ * @param [in] typeId      - type of the elements
+ * @param [in] edgeSize    - size of the domain, 0 for a single value
+ * @param [in] data        - data to write
+ */
+void WriteMaterialDataset(hid_t         h5fileId,
+                          const char   *datasetName,
+                          hid_t         typeId,
+                          const size_t  edgeSize,
+                          const void   *data)
+{
+    hsize_t dims[2] = {edgeSize, edgeSize};
+    hsize_t one[1]  = {1};
+
+    hid_t dataspace_id = (edgeSize > 0) ? H5Screate_simple(2, dims, NULL) : H5Screate_simple(1, one, NULL);
+    hid_t dataset_id   = H5Dcreate(h5fileId, datasetName, typeId, dataspace_id,
+                                   H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5Dwrite(dataset_id, typeId, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+
+    H5Dclose(dataset_id);
+    H5Sclose(dataspace_id);
+} // end of WriteMaterialDataset
+//------------------------------------------------------------------------------
+
+/**
+ * Get the grid of tiles of the decomposition, strips of whole rows or the
+ * grid chosen by MPI_Dims_create. Compute ranks and I/O servers have to get
+ * the same grid.
+ * @param [in]  nRanks - number of compute ranks
+ * @param [out] dims   - number of tiles in Y and X
+ */
+void GetDecompositionDims(const int nRanks,
+                          int       dims[2])
+{
+    if (extParameters.decompositionLayout == LAYOUT_STRIPS)
+    {
+        dims[0] = nRanks;
+        dims[1] = 1;
     }
     else
     {
-        // Create material properties and load from file
-        materialProperties.LoadMaterialData(parameters.materialFileName, false);
-        parameters.edgeSize = materialProperties.edgeSize;
+        dims[0] = 0;
+        dims[1] = 0;
+        MPI_Dims_create(nRanks, 2, dims);
+    }
+} // end of GetDecompositionDims
+//------------------------------------------------------------------------------
+
+/**
+ * Select strips or tiles. The computation is the same, the exchange differs:
+ * a strip sends halo width rows of the whole domain to both neighbours, a
+ * tile shorter rows, strided columns and for deep halos the corners. The
+ * probes use the halo width of the given depth (auto depth is selected after
+ * the layout, two wide halos are assumed). The latency, the bandwidth of
+ * contiguous rows and of strided columns are measured between pairs of ranks
+ * and the model
+ *   strips: 2 * (latency + rowBytes(edgeSize + 2 * haloWidth) / rowBandwidth)
+ *   tiles:  2 * (latency + rowBytes(tileWidth) / rowBandwidth) +
+ *           2 * (latency + columnBytes(tileHeight) / columnBandwidth) +
+ *           4 * (latency + columnBytes(haloWidth) / columnBandwidth) (deep halos)
+ * decides. The slowest pair decides, so all ranks select the same layout.
+ * @param [in] comm     - communicator of the compute ranks
+ * @param [in] edgeSize - size of the domain
+ * @return true for strips
+ */
+bool SelectStripDecomposition(MPI_Comm     comm,
+                              const size_t edgeSize)
+{
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    //Strips have to cover the halo zones of both neighbours
+    const size_t haloDepth = max(extParameters.haloDepth, 1);
+    if ((size == 1) || (edgeSize / size < max<size_t>(MIN_TILE_SIZE, 4 * haloDepth)))
+        return false;
+
+    int dims[2] = {0, 0};
+    MPI_Dims_create(size, 2, dims);
+    if (dims[1] == 1)
+        return false;
+
+    //The largest tile
+    const size_t tileHeight = (edgeSize + dims[0] - 1) / dims[0];
+    const size_t tileWidth  = (edgeSize + dims[1] - 1) / dims[1];
+
+    //Rows of the whole domain with its halo columns and columns of a tile with halo
+    //zones, as wide as the halos (CreateNeighbourGraph)
+    const size_t haloWidth   = 2 * haloDepth;
+    const size_t stripRow    = haloWidth * (edgeSize + 2 * haloWidth);
+    MPI_Datatype columnType;
+    MPI_Type_vector(tileHeight, haloWidth, tileWidth + 2 * haloWidth, MPI_FLOAT, &columnType);
+    MPI_Type_commit(&columnType);
+
+    vector<float> sendBuffer(max(stripRow, tileHeight * (tileWidth + 2 * haloWidth)), 0.0f);
+    vector<float> recvBuffer(sendBuffer.size(), 0.0f);
+
+    //Ranks exchange in pairs, the last one of an odd number has none
+    const int partner = ((rank ^ 1) < size) ? (rank ^ 1) : MPI_PROC_NULL;
+
+    //Latency, rows and columns: {count, type}
+    const int          counts[3] = {1,         (int) stripRow,       1};
+    const MPI_Datatype types[3]  = {MPI_FLOAT, MPI_FLOAT,            columnType};
+    double probes[3];
+
+    for (int p = 0; p < 3; p++)
+    {
+        MPI_Barrier(comm);
+        probes[p] = MPI_Wtime();
+        for (int r = 0; r < HALO_PROBE_REPETITIONS; r++)
+        {
+            MPI_Sendrecv(sendBuffer.data(), counts[p], types[p], partner, p,
+                         recvBuffer.data(), counts[p], types[p], partner, p,
+                         comm, MPI_STATUS_IGNORE);
+        }
+        probes[p] = (MPI_Wtime() - probes[p]) / HALO_PROBE_REPETITIONS;
     }
+    MPI_Type_free(&columnType);
+
+    MPI_Allreduce(MPI_IN_PLACE, probes, 3, MPI_DOUBLE, MPI_MAX, comm);
+
+    //Time of one element of a row and of a column
+    const double latency     = probes[0];
+    const double rowTime     = max(0.0, probes[1] - latency) / stripRow;
+    const double columnTime  = max(0.0, probes[2] - latency) / (haloWidth * tileHeight);
+
+    const double stripsTime  = 2 * (latency + stripRow * rowTime);
+    double       tilesTime   = 2 * (latency + haloWidth * tileWidth * rowTime) +
+                               2 * (latency + haloWidth * tileHeight * columnTime);
+    if (haloDepth > 1)
+        tilesTime += 4 * (latency + haloWidth * haloWidth * columnTime);
+
+    return stripsTime < tilesTime;
+} // end of SelectStripDecomposition
+//------------------------------------------------------------------------------
+
+/**
+ * Split the domain into a Cartesian grid of tiles. The grid is given by
+ * GetDecompositionDims, so any number of ranks can be used, and tiles in one
+ * row (column) of the grid get the same number of rows (columns) with the
+ * remainder spread over the first ones.
+ * @param [out] decomposition - decomposition of the domain
+ * @param [in]  edgeSize      - size of the domain
+ * @param [in]  comm          - communicator of all ranks
+ */
+void CreateDecomposition(TDecomposition &decomposition,
+                         const size_t    edgeSize,
+                         MPI_Comm        comm)
+{
+    int size, rank;
+    MPI_Comm_size(comm, &size);
+
+    int dims[2];
+    int periods[2] = {0, 0};
+    GetDecompositionDims(size, dims);
+
+    // keep the ranks of comm, rank 0 holds the whole domain
+    MPI_Cart_create(comm, 2, dims, periods, 0, &decomposition.cartComm);
+    MPI_Comm_rank(decomposition.cartComm, &rank);
+
+    int coords[2];
+    MPI_Cart_coords(decomposition.cartComm, rank, 2, coords);
 
-    if (parameters.edgeSize % size)
+    decomposition.rows   = dims[0];
+    decomposition.cols   = dims[1];
+    decomposition.iIndex = coords[0];
+    decomposition.jIndex = coords[1];
+
+    GetBlockRange(edgeSize, decomposition.rows, decomposition.iIndex,
+                  decomposition.tilePosY, decomposition.tileHeight);
+    GetBlockRange(edgeSize, decomposition.cols, decomposition.jIndex,
+                  decomposition.tilePosX, decomposition.tileWidth);
+
+    MPI_Cart_shift(decomposition.cartComm, 0, 1, &decomposition.topRank,  &decomposition.bottomRank);
+    MPI_Cart_shift(decomposition.cartComm, 1, 1, &decomposition.leftRank, &decomposition.rightRank);
+
+    // MPI_Cart_shift does not work diagonally
+    int *diagonalRanks[4] = {&decomposition.topLeftRank,    &decomposition.topRightRank,
+                             &decomposition.bottomLeftRank, &decomposition.bottomRightRank};
+    for (int d = 0; d < 4; d++)
     {
-        if (rank == 0)
-            printf("ERROR: number of MPI processes is not a divisor of N\n");
-        MPI_Abort(MPI_COMM_WORLD, 1);
+        int diagonalCoords[2] = {coords[0] + ((d < 2) ? -1 : 1), coords[1] + ((d % 2 == 0) ? -1 : 1)};
+
+        *diagonalRanks[d] = MPI_PROC_NULL;
+        if ((diagonalCoords[0] >= 0) && (diagonalCoords[0] < dims[0]) &&
+            (diagonalCoords[1] >= 0) && (diagonalCoords[1] < dims[1]))
+        {
+            MPI_Cart_rank(decomposition.cartComm, diagonalCoords, diagonalRanks[d]);
+        }
     }
 
-    if (parameters.IsRunSequntial())
+    // set by CreateNeighbourGraph
+    decomposition.haloWidth     = 0;
+    decomposition.neighbourComm = MPI_COMM_NULL;
+} // end of CreateDecomposition
+//------------------------------------------------------------------------------
+
+/**
+ * Set the width of halo zones and create the graph of the neighbours. Halos
+ * of depth k are 2k wide, deeper halos than one iteration are recomputed
+ * redundantly, so they also need the corners from the diagonal neighbours.
+ * @param [in, out] decomposition - decomposition of the domain
+ * @param [in]      haloDepth     - depth of halo zones in iterations
+ */
+void CreateNeighbourGraph(TDecomposition &decomposition,
+                          const int       haloDepth)
+{
+    decomposition.haloWidth = 2 * haloDepth;
+
+    int candidates[8];
+    GetHaloNeighbours(decomposition, candidates);
+
+    // the whole exchange pattern is given to the library at once
+    int neighbours[8];
+    int nNeighbours = 0;
+    for (int n = 0; n < 8; n++)
+        if (candidates[n] != MPI_PROC_NULL)
+            neighbours[nNeighbours++] = candidates[n];
+
+    MPI_Dist_graph_create_adjacent(decomposition.cartComm,
+                                   nNeighbours, neighbours, MPI_UNWEIGHTED,
+                                   nNeighbours, neighbours, MPI_UNWEIGHTED,
+                                   MPI_INFO_NULL, 0, &decomposition.neighbourComm);
+} // end of CreateNeighbourGraph
+//------------------------------------------------------------------------------
+
+/**
+ * Get the neighbours halos are exchanged with in the order left, right, top,
+ * bottom, top-left, top-right, bottom-left and bottom-right. The diagonal
+ * ones are MPI_PROC_NULL for two wide halos, the stencil does not reach them.
+ * @param [in]  decomposition - decomposition of the domain
+ * @param [out] neighbours    - ranks of the neighbours (MPI_PROC_NULL if none)
+ */
+void GetHaloNeighbours(const TDecomposition &decomposition,
+                       int                   neighbours[8])
+{
+    const bool corners = (decomposition.haloWidth > 2);
+
+    neighbours[0] = decomposition.leftRank;
+    neighbours[1] = decomposition.rightRank;
+    neighbours[2] = decomposition.topRank;
+    neighbours[3] = decomposition.bottomRank;
+    neighbours[4] = corners ? decomposition.topLeftRank     : MPI_PROC_NULL;
+    neighbours[5] = corners ? decomposition.topRightRank    : MPI_PROC_NULL;
+    neighbours[6] = corners ? decomposition.bottomLeftRank  : MPI_PROC_NULL;
+    neighbours[7] = corners ? decomposition.bottomRightRank : MPI_PROC_NULL;
+} // end of GetHaloNeighbours
+//------------------------------------------------------------------------------
+
+/**
+ * Select the depth of halo zones. Halos of depth k are exchanged once per k
+ * iterations, the ranks pay the latency once and recompute the shrinking
+ * halos in between, so the depth minimising
+ *   latency / k + pointTime * (tileHeight + 2(k - 1)) * (tileWidth + 2(k - 1))
+ * is taken. The latency of the exchange and the time of one point are
+ * measured and the slowest rank decides, so all ranks select the same depth.
+ * @param [in] decomposition - decomposition of the domain
+ * @param [in] parameters    - parameters of the simulation
+ * @return depth of halo zones in iterations
+ */
+int SelectHaloDepth(const TDecomposition &decomposition,
+                    const TParameters    &parameters)
+{
+    const size_t tileWidth  = decomposition.tileWidth;
+    const size_t tileHeight = decomposition.tileHeight;
+
+    //The largest tile decides the cost, the smallest one limits the depth
+    unsigned long tileSizes[2] = {tileHeight, tileWidth};
+    MPI_Allreduce(MPI_IN_PLACE, tileSizes, 2, MPI_UNSIGNED_LONG, MPI_MAX, decomposition.cartComm);
+    unsigned long minTileSize = min(tileWidth, tileHeight);
+    MPI_Allreduce(MPI_IN_PLACE, &minTileSize, 1, MPI_UNSIGNED_LONG, MPI_MIN, decomposition.cartComm);
+
+    //Latency of exchanging two wide strips with the neighbours, shifted in all four directions
+    const int stripSize = 2 * max(tileSizes[0], tileSizes[1]);
+    vector<float> sendStrip(stripSize, 0.0f), recvStrip(stripSize, 0.0f);
+    const int destinations[4] = {decomposition.rightRank, decomposition.leftRank,
+                                 decomposition.bottomRank, decomposition.topRank};
+    const int sources[4]      = {decomposition.leftRank, decomposition.rightRank,
+                                 decomposition.topRank, decomposition.bottomRank};
+
+    MPI_Barrier(decomposition.cartComm);
+    double latency = MPI_Wtime();
+    for (int r = 0; r < HALO_PROBE_REPETITIONS; r++)
     {
-        if (rank == 0)
+        for (int n = 0; n < 4; n++)
         {
-            // Memory allocation for output matrices.
-            seqResult = (float*)_mm_malloc(materialProperties.nGridPoints * sizeof(float), DATA_ALIGNMENT);
+            MPI_Sendrecv(sendStrip.data(), stripSize, MPI_FLOAT, destinations[n], n,
+                         recvStrip.data(), stripSize, MPI_FLOAT, sources[n], n,
+                         decomposition.cartComm, MPI_STATUS_IGNORE);
+        }
+    }
+    latency = (MPI_Wtime() - latency) / HALO_PROBE_REPETITIONS;
 
-            SequentialHeatDistribution(seqResult,
-                                       materialProperties,
-                                       parameters,
-                                       parameters.outputFileName);
+    //Time of one point computed on a homogeneous block
+    const size_t probeSize = HALO_PROBE_SIZE + 4;
+    vector<float> probeOld(probeSize * probeSize, 1.0f), probeNew(probeSize * probeSize, 1.0f);
+    vector<float> probeParams(probeSize * probeSize, 1.0f);
+    vector<int>   probeMap(probeSize * probeSize, 1);
+
+    double pointTime = MPI_Wtime();
+    for (int r = 0; r < HALO_PROBE_REPETITIONS; r++)
+    {
+        for (size_t i = 2; i < probeSize - 2; i++)
+            for (size_t j = 2; j < probeSize - 2; j++)
+                ComputePoint(probeOld.data(), probeNew.data(), probeParams.data(), probeMap.data(),
+                             i, j, probeSize, parameters.airFlowRate, 0.0f);
+        swap(probeOld, probeNew);
+    }
+    pointTime = (MPI_Wtime() - pointTime) / (HALO_PROBE_REPETITIONS * HALO_PROBE_SIZE * HALO_PROBE_SIZE);
+
+    //The team shares the tile only in the hybrid mode (the parallel region of the
+    //simulation is conditional), a single thread computes otherwise
+#ifdef _OPENMP
+    const bool hybrid = (parameters.nThreads > 1);
+#else
+    const bool hybrid = false;
+#endif
+    if (hybrid)
+        pointTime /= parameters.nThreads;
+
+    //The slowest rank decides
+    double probes[2] = {latency, pointTime};
+    MPI_Allreduce(MPI_IN_PLACE, probes, 2, MPI_DOUBLE, MPI_MAX, decomposition.cartComm);
+
+    //Both boundary strips of the halo width have to fit into the tile
+    const int maxDepth = min<int>(MAX_HALO_DEPTH, max<unsigned long>(minTileSize / 4, 1));
+
+    int    bestDepth = 1;
+    double bestTime  = probes[0] + probes[1] * tileSizes[0] * tileSizes[1];
+    for (int depth = 2; depth <= maxDepth; depth++)
+    {
+        const double time = probes[0] / depth +
+                            probes[1] * (tileSizes[0] + 2 * (depth - 1)) * (tileSizes[1] + 2 * (depth - 1));
+        if (time < bestTime)
+        {
+            bestTime  = time;
+            bestDepth = depth;
         }
     }
 
-    if (parameters.IsRunParallel())
+    return bestDepth;
+} // end of SelectHaloDepth
+//------------------------------------------------------------------------------
+
+/**
+ * Get the start and the size of one of the blocks the range is split into.
+ * The first (length % nBlocks) blocks are one element longer.
+ * @param [in]  length    - length of the range
+ * @param [in]  nBlocks   - number of blocks
+ * @param [in]  blockId   - id of the block
+ * @param [out] start     - first element of the block
+ * @param [out] blockSize - number of elements of the block
+ */
+void GetBlockRange(const size_t  length,
+                   const int     nBlocks,
+                   const int     blockId,
+                   size_t       &start,
+                   size_t       &blockSize)
+{
+    const size_t base      = length / nBlocks;
+    const size_t remainder = length % nBlocks;
+
+    blockSize = base + ((size_t) blockId < remainder ? 1 : 0);
+    start     = blockId * base + min((size_t) blockId, remainder);
+} // end of GetBlockRange
+//------------------------------------------------------------------------------
+
+/**
+ * Create the halo exchange of tile arrays with the given element type.
+ * Neighbours are in the order of the graph communicator (left, right, top,
+ * bottom and the diagonal ones), every one gets the boundary columns (rows)
+ * of the halo width next to it and fills the halo columns (rows) on its side.
+ * @param [out] haloExchange  - halo exchange
+ * @param [in]  decomposition - decomposition of the domain
+ * @param [in]  elementType   - type of one element (MPI_FLOAT, MPI_INT)
+ */
+void CreateHaloExchange(THaloExchange        &haloExchange,
+                        const TDecomposition &decomposition,
+                        MPI_Datatype          elementType)
+{
+    const size_t tileWidth  = decomposition.tileWidth;
+    const size_t tileHeight = decomposition.tileHeight;
+    const size_t haloWidth  = decomposition.haloWidth;
+    const size_t rowSize    = tileWidth + 2 * haloWidth;
+
+    int elementSize;
+    MPI_Type_size(elementType, &elementSize);
+
+    //Columns, rows and corners of the halo width
+    int localDims[2]  = {tileHeight + 2 * haloWidth, tileWidth + 2 * haloWidth};
+    int columnDims[2] = {tileHeight, haloWidth};
+    int rowDims[2]    = {haloWidth, tileWidth};
+    int cornerDims[2] = {haloWidth, haloWidth};
+    int start[2]      = {0, 0};
+    MPI_Type_create_subarray(2, localDims, columnDims, start, MPI_ORDER_C, elementType, &haloExchange.columnType);
+    MPI_Type_create_subarray(2, localDims, cornerDims, start, MPI_ORDER_C, elementType, &haloExchange.cornerType);
+
+    //Strips exchange whole rows with the halo columns, they are contiguous
+    const bool strips = (decomposition.cols == 1);
+    const size_t rowStart = strips ? 0 : haloWidth;
+    if (strips)
+        MPI_Type_contiguous(haloWidth * rowSize, elementType, &haloExchange.rowType);
+    else
+        MPI_Type_create_subarray(2, localDims, rowDims, start, MPI_ORDER_C, elementType, &haloExchange.rowType);
+    MPI_Type_commit(&haloExchange.columnType);
+    MPI_Type_commit(&haloExchange.rowType);
+    MPI_Type_commit(&haloExchange.cornerType);
+
+    haloExchange.comm = decomposition.neighbourComm;
+    haloExchange.counts.clear();
+    haloExchange.sendDispls.clear();
+    haloExchange.recvDispls.clear();
+    haloExchange.types.clear();
+    haloExchange.sendCounts.clear();
+    haloExchange.packedDispls.clear();
+    haloExchange.sendTypes.clear();
+    haloExchange.blockOffsets.clear();
+    haloExchange.blockRows.clear();
+    haloExchange.blockCols.clear();
+    haloExchange.elementSize    = elementSize;
+    haloExchange.rowSize        = rowSize;
+    haloExchange.sendBufferSize = 0;
+
+    //Left, right, top, bottom and diagonal neighbours: {rank, sent strip, received halo, type}
+    int neighbours[8];
+    GetHaloNeighbours(decomposition, neighbours);
+    const size_t sendOffsets[8] = {haloWidth * rowSize + haloWidth,              haloWidth * rowSize + tileWidth,
+                                   haloWidth * rowSize + rowStart,               tileHeight * rowSize + rowStart,
+                                   haloWidth * rowSize + haloWidth,              haloWidth * rowSize + tileWidth,
+                                   tileHeight * rowSize + haloWidth,             tileHeight * rowSize + tileWidth};
+    const size_t recvOffsets[8] = {haloWidth * rowSize + 0,                      haloWidth * rowSize + tileWidth + haloWidth,
+                                   0 * rowSize + rowStart,                       (tileHeight + haloWidth) * rowSize + rowStart,
+                                   0 * rowSize + 0,                              0 * rowSize + tileWidth + haloWidth,
+                                   (tileHeight + haloWidth) * rowSize + 0,       (tileHeight + haloWidth) * rowSize + tileWidth + haloWidth};
+    const MPI_Datatype types[8] = {haloExchange.columnType, haloExchange.columnType,
+                                   haloExchange.rowType,    haloExchange.rowType,
+                                   haloExchange.cornerType, haloExchange.cornerType,
+                                   haloExchange.cornerType, haloExchange.cornerType};
+    const size_t rowWidth     = strips ? rowSize : tileWidth;
+    const size_t blockRows[8] = {tileHeight, tileHeight, haloWidth, haloWidth, haloWidth, haloWidth, haloWidth, haloWidth};
+    const size_t blockCols[8] = {haloWidth,  haloWidth,  rowWidth,  rowWidth,  haloWidth, haloWidth, haloWidth, haloWidth};
+
+    for (int n = 0; n < 8; n++)
     {
-        // Memory allocation for output matrix.
-        if (rank == 0)
-            parResult = (float*) _mm_malloc(materialProperties.nGridPoints * sizeof(float), DATA_ALIGNMENT);
-        else
-            parResult = NULL;
+        if (neighbours[n] == MPI_PROC_NULL) continue;
+
+        haloExchange.counts.push_back(1);
+        haloExchange.sendDispls.push_back(sendOffsets[n] * elementSize);
+        haloExchange.recvDispls.push_back(recvOffsets[n] * elementSize);
+        haloExchange.types.push_back(types[n]);
+
+        haloExchange.sendCounts.push_back(blockRows[n] * blockCols[n]);
+        haloExchange.packedDispls.push_back(haloExchange.sendBufferSize);
+        haloExchange.sendTypes.push_back(elementType);
+        haloExchange.blockOffsets.push_back(sendOffsets[n]);
+        haloExchange.blockRows.push_back(blockRows[n]);
+        haloExchange.blockCols.push_back(blockCols[n]);
+        haloExchange.sendBufferSize += blockRows[n] * blockCols[n] * elementSize;
+    }
+} // end of CreateHaloExchange
+//------------------------------------------------------------------------------
+
+/**
+ * Free the halo exchange
+ * @param [in, out] haloExchange - halo exchange
+ */
+void FreeHaloExchange(THaloExchange &haloExchange)
+{
+    MPI_Type_free(&haloExchange.columnType);
+    MPI_Type_free(&haloExchange.rowType);
+    MPI_Type_free(&haloExchange.cornerType);
+} // end of FreeHaloExchange
+//------------------------------------------------------------------------------
+
+/**
+ * Allocate both ping-pong tiles of every rank in a shared memory window of its
+ * node and get the tiles of the left, right, top and bottom neighbours which
+ * share the node. The window stays locked for the whole simulation, ranks are
+ * synchronised by the halo messages.
+ * @param [out] sharedTiles   - shared tiles
+ * @param [in]  decomposition - decomposition of the domain (two wide halos)
+ * @param [in]  edgeSize      - size of the domain
+ */
+void CreateSharedTiles(TSharedTiles         &sharedTiles,
+                       const TDecomposition &decomposition,
+                       const size_t          edgeSize)
+{
+    const size_t localSize = (decomposition.tileHeight + 2 * decomposition.haloWidth) *
+                             (decomposition.tileWidth  + 2 * decomposition.haloWidth);
+
+    MPI_Comm_split_type(decomposition.cartComm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &sharedTiles.nodeComm);
+
+    //Segments of the ranks need not be contiguous, each one stays local to its owner
+    MPI_Info info;
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "alloc_shared_noncontig", "true");
+    MPI_Win_allocate_shared(2 * localSize * sizeof(float), sizeof(float), info,
+                            sharedTiles.nodeComm, &sharedTiles.tiles, &sharedTiles.window);
+    MPI_Info_free(&info);
+
+    MPI_Group cartGroup, nodeGroup;
+    MPI_Comm_group(decomposition.cartComm, &cartGroup);
+    MPI_Comm_group(sharedTiles.nodeComm, &nodeGroup);
+
+    //Left, right, top, bottom: {rank, row, column of the tile}
+    const int neighbours[4] = {decomposition.leftRank, decomposition.rightRank,
+                               decomposition.topRank,  decomposition.bottomRank};
+    const int iIndices[4]   = {decomposition.iIndex,     decomposition.iIndex,
+                               decomposition.iIndex - 1, decomposition.iIndex + 1};
+    const int jIndices[4]   = {decomposition.jIndex - 1, decomposition.jIndex + 1,
+                               decomposition.jIndex,     decomposition.jIndex};
+
+    for (int n = 0; n < 4; n++)
+    {
+        sharedTiles.neighbourTiles[n]   = NULL;
+        sharedTiles.neighbourHeights[n] = 0;
+        sharedTiles.neighbourWidths[n]  = 0;
 
-        ParallelHeatDistribution(parResult,
-                                 materialProperties,
-                                 parameters,
-                                 parameters.outputFileName);
+        if (neighbours[n] == MPI_PROC_NULL) continue;
+
+        int nodeRank;
+        MPI_Group_translate_ranks(cartGroup, 1, &neighbours[n], nodeGroup, &nodeRank);
+        if (nodeRank == MPI_UNDEFINED) continue;
+
+        MPI_Aint segmentSize;
+        int      dispUnit;
+        MPI_Win_shared_query(sharedTiles.window, nodeRank, &segmentSize, &dispUnit, &sharedTiles.neighbourTiles[n]);
+
+        size_t start;
+        GetBlockRange(edgeSize, decomposition.rows, iIndices[n], start, sharedTiles.neighbourHeights[n]);
+        GetBlockRange(edgeSize, decomposition.cols, jIndices[n], start, sharedTiles.neighbourWidths[n]);
     }
 
-    // Validate the outputs
-    if (parameters.IsValidation() && rank == 0)
+    MPI_Group_free(&cartGroup);
+    MPI_Group_free(&nodeGroup);
+
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, sharedTiles.window);
+} // end of CreateSharedTiles
+//------------------------------------------------------------------------------
+
+/**
+ * Free the shared memory window
+ * @param [in, out] sharedTiles - shared tiles
+ */
+void FreeSharedTiles(TSharedTiles &sharedTiles)
+{
+    MPI_Win_unlock_all(sharedTiles.window);
+    MPI_Win_free(&sharedTiles.window);
+    MPI_Comm_free(&sharedTiles.nodeComm);
+} // end of FreeSharedTiles
+//------------------------------------------------------------------------------
+
+/**
+ * Copy halos of the tile from the same tile of the neighbours sharing the node.
+ * The neighbours must have announced their boundary strips are written.
+ * @param [in]      sharedTiles   - shared tiles
+ * @param [in]      decomposition - decomposition of the domain (two wide halos)
+ * @param [in, out] tile          - tile of this rank in the window
+ * @param [in]      tileIndex     - which of the ping-pong tiles it is
+ */
+void CopySharedHalos(const TSharedTiles   &sharedTiles,
+                     const TDecomposition &decomposition,
+                     float                *tile,
+                     const int             tileIndex)
+{
+    const size_t halo       = decomposition.haloWidth;
+    const size_t tileWidth  = decomposition.tileWidth;
+    const size_t tileHeight = decomposition.tileHeight;
+    const size_t rowSize    = tileWidth + 2 * halo;
+
+    //Strips copy whole rows with the halo columns at once
+    const bool   strips     = (decomposition.cols == 1);
+
+    for (int n = 0; n < 4; n++)
     {
-        if (parameters.debugFlag)
+        if (sharedTiles.neighbourTiles[n] == NULL) continue;
+
+        const size_t neighbourWidth   = sharedTiles.neighbourWidths[n];
+        const size_t neighbourRowSize = neighbourWidth + 2 * halo;
+        const float *neighbourTile    = sharedTiles.neighbourTiles[n] +
+                                        tileIndex * (sharedTiles.neighbourHeights[n] + 2 * halo) * neighbourRowSize;
+
+        switch (n)
         {
-            printf("---------------- Sequential results ---------------\n");
-            PrintArray(seqResult, materialProperties.edgeSize);
+            case 0: //Left halo from the right boundary columns of the left neighbour
+                for (size_t i = halo; i < tileHeight + halo; i++)
+                    memcpy(&tile[i * rowSize], &neighbourTile[i * neighbourRowSize + neighbourWidth], halo * sizeof(float));
+                break;
+            case 1: //Right halo from the left boundary columns of the right neighbour
+                for (size_t i = halo; i < tileHeight + halo; i++)
+                    memcpy(&tile[i * rowSize + tileWidth + halo], &neighbourTile[i * neighbourRowSize + halo], halo * sizeof(float));
+                break;
+            case 2: //Top halo from the bottom boundary rows of the top neighbour
+                if (strips)
+                    memcpy(&tile[0], &neighbourTile[sharedTiles.neighbourHeights[n] * neighbourRowSize],
+                           halo * rowSize * sizeof(float));
+                else
+                    for (size_t i = 0; i < halo; i++)
+                        memcpy(&tile[i * rowSize + halo],
+                               &neighbourTile[(sharedTiles.neighbourHeights[n] + i) * neighbourRowSize + halo],
+                               tileWidth * sizeof(float));
+                break;
+            case 3: //Bottom halo from the top boundary rows of the bottom neighbour
+                if (strips)
+                    memcpy(&tile[(tileHeight + halo) * rowSize], &neighbourTile[halo * neighbourRowSize],
+                           halo * rowSize * sizeof(float));
+                else
+                    for (size_t i = 0; i < halo; i++)
+                        memcpy(&tile[(tileHeight + halo + i) * rowSize + halo],
+                               &neighbourTile[(halo + i) * neighbourRowSize + halo],
+                               tileWidth * sizeof(float));
+                break;
+        }
+    }
+} // end of CopySharedHalos
+//------------------------------------------------------------------------------
 
-            printf("----------------- Parallel results ----------------\n");
-            PrintArray(parResult, materialProperties.edgeSize);
+/**
+ * Create the one-sided halo exchange of the ping-pong tiles. Every tile is
+ * exposed in its own window, the left, right, top and bottom neighbours put
+ * their boundary strips of the two wide halo into its halo zones. The strips
+ * of left and right neighbours have the same height, of top and bottom ones
+ * the same width, only the row size of the target may differ.
+ * @param [out] rmaHaloExchange - one-sided halo exchange
+ * @param [in]  decomposition   - decomposition of the domain (two wide halos)
+ * @param [in]  edgeSize        - size of the domain
+ * @param [in]  tiles           - both ping-pong tiles
+ */
+void CreateRmaHaloExchange(TRmaHaloExchange     &rmaHaloExchange,
+                           const TDecomposition &decomposition,
+                           const size_t          edgeSize,
+                           float                *tiles[2])
+{
+    const size_t halo       = decomposition.haloWidth;
+    const size_t tileWidth  = decomposition.tileWidth;
+    const size_t tileHeight = decomposition.tileHeight;
+    const size_t rowSize    = tileWidth + 2 * halo;
+    const size_t localSize  = rowSize * (tileHeight + 2 * halo);
+
+    //Strips put whole rows with the halo columns, they are contiguous
+    const bool   strips     = (decomposition.cols == 1);
+    const size_t rowStart   = strips ? 0 : halo;
+
+    //Windows are synchronised by post/start/complete/wait only
+    MPI_Info info;
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "no_locks", "true");
+    for (int tileIndex = 0; tileIndex < 2; tileIndex++)
+    {
+        MPI_Win_create(tiles[tileIndex], localSize * sizeof(float), sizeof(float), info,
+                       decomposition.cartComm, &rmaHaloExchange.windows[tileIndex]);
+    }
+    MPI_Info_free(&info);
+
+    //Left, right, top, bottom: {rank, row, column of the tile}
+    const int neighbours[4] = {decomposition.leftRank, decomposition.rightRank,
+                               decomposition.topRank,  decomposition.bottomRank};
+    const int iIndices[4]   = {decomposition.iIndex,     decomposition.iIndex,
+                               decomposition.iIndex - 1, decomposition.iIndex + 1};
+    const int jIndices[4]   = {decomposition.jIndex - 1, decomposition.jIndex + 1,
+                               decomposition.jIndex,     decomposition.jIndex};
+
+    rmaHaloExchange.nTargets = 0;
+    for (int n = 0; n < 4; n++)
+    {
+        if (neighbours[n] == MPI_PROC_NULL) continue;
+
+        size_t start, neighbourHeight, neighbourWidth;
+        GetBlockRange(edgeSize, decomposition.rows, iIndices[n], start, neighbourHeight);
+        GetBlockRange(edgeSize, decomposition.cols, jIndices[n], start, neighbourWidth);
+        const size_t neighbourRowSize = neighbourWidth + 2 * halo;
+
+        const int t = rmaHaloExchange.nTargets++;
+        rmaHaloExchange.targetRanks[t] = neighbours[n];
+
+        switch (n)
+        {
+            case 0: //Left boundary columns into the right halo of the left neighbour
+                rmaHaloExchange.originOffsets[t] = halo * rowSize + halo;
+                rmaHaloExchange.targetDispls[t]  = halo * neighbourRowSize + neighbourWidth + halo;
+                break;
+            case 1: //Right boundary columns into the left halo of the right neighbour
+                rmaHaloExchange.originOffsets[t] = halo * rowSize + tileWidth;
+                rmaHaloExchange.targetDispls[t]  = halo * neighbourRowSize + 0;
+                break;
+            case 2: //Top boundary rows into the bottom halo of the top neighbour
+                rmaHaloExchange.originOffsets[t] = halo * rowSize + rowStart;
+                rmaHaloExchange.targetDispls[t]  = (neighbourHeight + halo) * neighbourRowSize + rowStart;
+                break;
+            case 3: //Bottom boundary rows into the top halo of the bottom neighbour
+                rmaHaloExchange.originOffsets[t] = tileHeight * rowSize + rowStart;
+                rmaHaloExchange.targetDispls[t]  = 0 * neighbourRowSize + rowStart;
+                break;
+        }
+
+        if (n < 2)
+        {
+            MPI_Type_vector(tileHeight, halo, rowSize,          MPI_FLOAT, &rmaHaloExchange.originTypes[t]);
+            MPI_Type_vector(tileHeight, halo, neighbourRowSize, MPI_FLOAT, &rmaHaloExchange.targetTypes[t]);
+        }
+        else if (strips)
+        {
+            MPI_Type_contiguous(halo * rowSize, MPI_FLOAT, &rmaHaloExchange.originTypes[t]);
+            MPI_Type_contiguous(halo * rowSize, MPI_FLOAT, &rmaHaloExchange.targetTypes[t]);
+        }
+        else
+        {
+            MPI_Type_vector(halo, tileWidth, rowSize,          MPI_FLOAT, &rmaHaloExchange.originTypes[t]);
+            MPI_Type_vector(halo, tileWidth, neighbourRowSize, MPI_FLOAT, &rmaHaloExchange.targetTypes[t]);
+        }
+        MPI_Type_commit(&rmaHaloExchange.originTypes[t]);
+        MPI_Type_commit(&rmaHaloExchange.targetTypes[t]);
+    }
+
+    //Neighbours are symmetric, the same group accesses and is accessed
+    MPI_Group cartGroup;
+    MPI_Comm_group(decomposition.cartComm, &cartGroup);
+    MPI_Group_incl(cartGroup, rmaHaloExchange.nTargets, rmaHaloExchange.targetRanks, &rmaHaloExchange.neighbourGroup);
+    MPI_Group_free(&cartGroup);
+} // end of CreateRmaHaloExchange
+//------------------------------------------------------------------------------
+
+/**
+ * Free the one-sided halo exchange
+ * @param [in, out] rmaHaloExchange - one-sided halo exchange
+ */
+void FreeRmaHaloExchange(TRmaHaloExchange &rmaHaloExchange)
+{
+    for (int t = 0; t < rmaHaloExchange.nTargets; t++)
+    {
+        MPI_Type_free(&rmaHaloExchange.originTypes[t]);
+        MPI_Type_free(&rmaHaloExchange.targetTypes[t]);
+    }
+    MPI_Group_free(&rmaHaloExchange.neighbourGroup);
+    MPI_Win_free(&rmaHaloExchange.windows[0]);
+    MPI_Win_free(&rmaHaloExchange.windows[1]);
+} // end of FreeRmaHaloExchange
+//------------------------------------------------------------------------------
+
+/**
+ * Put boundary strips of the tile into the halos of the same tile of the
+ * neighbours. The access epoch is closed by MPI_Win_complete, the tile must
+ * be exposed to the neighbours by MPI_Win_post.
+ * @param [in] rmaHaloExchange - one-sided halo exchange
+ * @param [in] tile            - tile with computed boundary strips
+ * @param [in] tileIndex       - which of the ping-pong tiles it is
+ */
+void StartRmaHaloExchange(const TRmaHaloExchange &rmaHaloExchange,
+                          const float            *tile,
+                          const int               tileIndex)
+{
+    MPI_Win window = rmaHaloExchange.windows[tileIndex];
+
+    MPI_Win_start(rmaHaloExchange.neighbourGroup, 0, window);
+    for (int t = 0; t < rmaHaloExchange.nTargets; t++)
+    {
+        MPI_Put(&tile[rmaHaloExchange.originOffsets[t]], 1, rmaHaloExchange.originTypes[t],
+                rmaHaloExchange.targetRanks[t], rmaHaloExchange.targetDispls[t], 1, rmaHaloExchange.targetTypes[t],
+                window);
+    }
+} // end of StartRmaHaloExchange
+//------------------------------------------------------------------------------
+
+/**
+ * Test whether the halo exchange completed. Most MPI libraries move large
+ * messages only inside MPI calls, so the test also progresses the exchange.
+ * One-sided exchanges test the exposure epoch, which completes the epoch.
+ * @param [in]      nRequests      - number of requests of the exchange
+ * @param [in, out] requests       - requests of the exchange
+ * @param [in]      exposureWindow - window of the one-sided exchange, MPI_WIN_NULL for none
+ * @return true if all halos arrived
+ */
+bool TestHaloExchange(const int    nRequests,
+                      MPI_Request *requests,
+                      MPI_Win      exposureWindow)
+{
+    int flag;
+    if (exposureWindow != MPI_WIN_NULL)
+        MPI_Win_test(exposureWindow, &flag);
+    else
+        MPI_Testall(nRequests, requests, &flag, MPI_STATUSES_IGNORE);
+
+    return flag != 0;
+} // end of TestHaloExchange
+//------------------------------------------------------------------------------
+
+/**
+ * Pack a block of rows of two wide columns of a tile into a contiguous buffer
+ * of pairs. The pairs of two rows are moved into one SSE register (64-bit
+ * loads into its low and high half) and stored at once, the row-major strip
+ * of stride rowSize becomes the packed 2 x nRows buffer.
+ * @param [in]  column   - first element of the columns in the first row of the tile
+ * @param [out] buffer   - buffer of the pairs of all rows of the tile
+ * @param [in]  rowSize  - size of a row of the tile with halo zones
+ * @param [in]  firstRow - first row of the block
+ * @param [in]  nRows    - number of rows of the block
+ */
+void PackColumns(const float  *column,
+                 float        *buffer,
+                 const size_t  rowSize,
+                 const size_t  firstRow,
+                 const size_t  nRows)
+{
+    size_t i = firstRow;
+    for (; i + 1 < firstRow + nRows; i += 2)
+    {
+        __m128 pairs = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *) &column[i * rowSize]);
+        pairs        = _mm_loadh_pi(pairs,            (const __m64 *) &column[(i + 1) * rowSize]);
+        _mm_storeu_ps(&buffer[2 * i], pairs);
+    }
+    for (; i < firstRow + nRows; i++)
+    {
+        buffer[2 * i]     = column[i * rowSize];
+        buffer[2 * i + 1] = column[i * rowSize + 1];
+    }
+} // end of PackColumns
+//------------------------------------------------------------------------------
+
+/**
+ * Unpack a block of rows of two wide columns of a tile from a contiguous
+ * buffer of pairs (reverse of PackColumns)
+ * @param [in]  buffer   - buffer of the pairs of all rows of the tile
+ * @param [out] column   - first element of the columns in the first row of the tile
+ * @param [in]  rowSize  - size of a row of the tile with halo zones
+ * @param [in]  firstRow - first row of the block
+ * @param [in]  nRows    - number of rows of the block
+ */
+void UnpackColumns(const float  *buffer,
+                   float        *column,
+                   const size_t  rowSize,
+                   const size_t  firstRow,
+                   const size_t  nRows)
+{
+    size_t i = firstRow;
+    for (; i + 1 < firstRow + nRows; i += 2)
+    {
+        const __m128 pairs = _mm_loadu_ps(&buffer[2 * i]);
+        _mm_storel_pi((__m64 *) &column[i * rowSize],       pairs);
+        _mm_storeh_pi((__m64 *) &column[(i + 1) * rowSize], pairs);
+    }
+    for (; i < firstRow + nRows; i++)
+    {
+        column[i * rowSize]     = buffer[2 * i];
+        column[i * rowSize + 1] = buffer[2 * i + 1];
+    }
+} // end of UnpackColumns
+//------------------------------------------------------------------------------
+
+/**
+ * Round a float to the nearest half precision value (ties to even). Values
+ * out of the range of the half precision saturate to infinity, small values
+ * become subnormal or zero.
+ * @param [in] value - float value
+ * @return half precision bits
+ */
+uint16_t FloatToHalf(const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint16_t sign     = (bits >> 16) & 0x8000;
+    const int      exponent = int((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t       mantissa = bits & 0x7fffff;
+
+    //Infinity and NaN
+    if(((bits >> 23) & 0xff) == 0xff)
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    if(exponent >= 31)
+        return sign | 0x7c00;
+
+    //Subnormal (or zero) half, the implicit one is shifted into the mantissa
+    if(exponent <= 0)
+    {
+        if(exponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        const uint32_t shift     = 14 - exponent;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway   = 1u << (shift - 1);
+        uint16_t half = mantissa >> shift;
+        if(remainder > halfway || (remainder == halfway && (half & 1)))
+            half++;
+        return sign | half;
+    }
+
+    //Normal half, a carry of the rounding propagates into the exponent
+    uint16_t half = (exponent << 10) | (mantissa >> 13);
+    const uint32_t remainder = mantissa & 0x1fff;
+    if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        half++;
+    return sign | half;
+} // end of FloatToHalf
+//------------------------------------------------------------------------------
+
+/**
+ * Widen a half precision value to a float (exact)
+ * @param [in] value - half precision bits
+ * @return float value
+ */
+float HalfToFloat(const uint16_t value)
+{
+    const uint32_t sign     = uint32_t(value & 0x8000) << 16;
+    int            exponent = (value >> 10) & 0x1f;
+    uint32_t       mantissa = value & 0x3ff;
+    uint32_t       bits;
+
+    if(exponent == 0)
+    {
+        if(mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            //Subnormal half is a normal float
+            exponent = 1;
+            while(!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            mantissa &= 0x3ff;
+            bits = sign | (uint32_t(exponent + 112) << 23) | (mantissa << 13);
+        }
+    }
+    else if(exponent == 31)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | (uint32_t(exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+} // end of HalfToFloat
+//------------------------------------------------------------------------------
+
+/**
+ * Convert an array of floats to half precision, by F16C if the compiler
+ * targets it (8 values at once), the rest by FloatToHalf.
+ * @param [in]  source      - floats
+ * @param [out] destination - half precision values
+ * @param [in]  size        - number of values
+ */
+void ConvertToHalf(const float  *source,
+                   uint16_t     *destination,
+                   const size_t  size)
+{
+    size_t i = 0;
+#ifdef __F16C__
+    for (; i + 8 <= size; i += 8)
+    {
+        const __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(&source[i]), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i *) &destination[i], halves);
+    }
+#endif
+    for (; i < size; i++)
+    {
+        destination[i] = FloatToHalf(source[i]);
+    }
+} // end of ConvertToHalf
+//------------------------------------------------------------------------------
+
+/**
+ * Convert an array of half precision values to floats (reverse of ConvertToHalf)
+ * @param [in]  source      - half precision values
+ * @param [out] destination - floats
+ * @param [in]  size        - number of values
+ */
+void ConvertFromHalf(const uint16_t *source,
+                     float          *destination,
+                     const size_t    size)
+{
+    size_t i = 0;
+#ifdef __F16C__
+    for (; i + 8 <= size; i += 8)
+    {
+        const __m128i halves = _mm_loadu_si128((const __m128i *) &source[i]);
+        _mm256_storeu_ps(&destination[i], _mm256_cvtph_ps(halves));
+    }
+#endif
+    for (; i < size; i++)
+    {
+        destination[i] = HalfToFloat(source[i]);
+    }
+} // end of ConvertFromHalf
+//------------------------------------------------------------------------------
+
+/**
+ * Start the exchange of halos of the tile array. The boundary strips are
+ * packed into the send buffer first, the halos are received directly into
+ * the tile (a collective must not send from and receive into the same array).
+ * @param [in]      haloExchange - halo exchange
+ * @param [in, out] tile         - local array with halo zones
+ * @param [out]     sendBuffer   - buffer of sendBufferSize bytes, untouched until the request completes
+ * @param [out]     request      - request to wait for
+ */
+void StartHaloExchange(const THaloExchange &haloExchange,
+                       void                *tile,
+                       void                *sendBuffer,
+                       MPI_Request         *request)
+{
+    const char *source      = (const char *) tile;
+    char       *destination = (char *) sendBuffer;
+    const size_t elementSize = haloExchange.elementSize;
+
+    for (size_t n = 0; n < haloExchange.blockOffsets.size(); n++)
+    {
+        const size_t blockBytes = haloExchange.blockCols[n] * elementSize;
+        for (size_t r = 0; r < haloExchange.blockRows[n]; r++)
+        {
+            memcpy(&destination[haloExchange.packedDispls[n] + r * blockBytes],
+                   &source[(haloExchange.blockOffsets[n] + r * haloExchange.rowSize) * elementSize],
+                   blockBytes);
+        }
+    }
+
+    MPI_Ineighbor_alltoallw(sendBuffer, haloExchange.sendCounts.data(), haloExchange.packedDispls.data(), haloExchange.sendTypes.data(),
+                            tile,       haloExchange.counts.data(),     haloExchange.recvDispls.data(),   haloExchange.types.data(),
+                            haloExchange.comm, request);
+} // end of StartHaloExchange
+//------------------------------------------------------------------------------
+
+/**
+ * Create datatypes for scattering and gathering the tiles. Every rank gets
+ * the type of its tile inside the local array with halo zones, rank 0 also
+ * the types of the tiles of all ranks inside the domain.
+ * @param [out] tileTypes     - datatypes of the tiles
+ * @param [in]  decomposition - decomposition of the domain
+ * @param [in]  edgeSize      - size of the domain
+ * @param [in]  elementType   - type of one element (MPI_FLOAT, MPI_INT)
+ */
+void CreateTileTypes(TTileTypes           &tileTypes,
+                     const TDecomposition &decomposition,
+                     const size_t          edgeSize,
+                     MPI_Datatype          elementType)
+{
+    int rank, size;
+    MPI_Comm_rank(decomposition.cartComm, &rank);
+    MPI_Comm_size(decomposition.cartComm, &size);
+
+    tileTypes.elementType = elementType;
+
+    //Tile without halos
+    int localDims[2]  = {decomposition.tileHeight + 2 * decomposition.haloWidth,
+                         decomposition.tileWidth  + 2 * decomposition.haloWidth};
+    int tileDims[2]   = {decomposition.tileHeight, decomposition.tileWidth};
+    int localStart[2] = {decomposition.haloWidth, decomposition.haloWidth};
+    MPI_Type_create_subarray(2, localDims, tileDims, localStart, MPI_ORDER_C, elementType, &tileTypes.tileType);
+    MPI_Type_commit(&tileTypes.tileType);
+
+    //Tiles of all ranks in the domain
+    tileTypes.domainTileTypes.clear();
+    if (rank == 0)
+    {
+        tileTypes.domainTileTypes.resize(size);
+        for (int r = 0; r < size; r++)
+        {
+            int coords[2];
+            MPI_Cart_coords(decomposition.cartComm, r, 2, coords);
+
+            size_t posY, posX, height, width;
+            GetBlockRange(edgeSize, decomposition.rows, coords[0], posY, height);
+            GetBlockRange(edgeSize, decomposition.cols, coords[1], posX, width);
+
+            int domainDims[2]       = {edgeSize, edgeSize};
+            int domainTileDims[2]   = {height, width};
+            int domainTileStart[2]  = {posY, posX};
+            MPI_Type_create_subarray(2, domainDims, domainTileDims, domainTileStart, MPI_ORDER_C, elementType,
+                                     &tileTypes.domainTileTypes[r]);
+            MPI_Type_commit(&tileTypes.domainTileTypes[r]);
+        }
+    }
+} // end of CreateTileTypes
+//------------------------------------------------------------------------------
+
+/**
+ * Free datatypes of the tiles
+ * @param [in, out] tileTypes - datatypes of the tiles
+ */
+void FreeTileTypes(TTileTypes &tileTypes)
+{
+    MPI_Type_free(&tileTypes.tileType);
+    for (size_t r = 0; r < tileTypes.domainTileTypes.size(); r++)
+        MPI_Type_free(&tileTypes.domainTileTypes[r]);
+    tileTypes.domainTileTypes.clear();
+} // end of FreeTileTypes
+//------------------------------------------------------------------------------
+
+/**
+ * Scatter the domain from rank 0 into the tiles. Tiles differ in size, so
+ * MPI_Alltoallw with a datatype per rank is used instead of MPI_Scatterv,
+ * only rank 0 sends.
+ * @param [in]  domain        - whole domain (rank 0 only)
+ * @param [out] tile          - local array with halo zones
+ * @param [in]  tileTypes     - datatypes of the tiles
+ * @param [in]  decomposition - decomposition of the domain
+ */
+void ScatterTiles(const void           *domain,
+                  void                 *tile,
+                  const TTileTypes     &tileTypes,
+                  const TDecomposition &decomposition)
+{
+    int rank, size;
+    MPI_Comm_rank(decomposition.cartComm, &rank);
+    MPI_Comm_size(decomposition.cartComm, &size);
+
+    vector<int>          sendcounts(size, 0), recvcounts(size, 0), displs(size, 0);
+    vector<MPI_Datatype> sendtypes(size, tileTypes.elementType), recvtypes(size, tileTypes.elementType);
+
+    if (rank == 0)
+    {
+        for (int r = 0; r < size; r++)
+        {
+            sendcounts[r] = 1;
+            sendtypes[r]  = tileTypes.domainTileTypes[r];
+        }
+    }
+    recvcounts[0] = 1;
+    recvtypes[0]  = tileTypes.tileType;
+
+    MPI_Alltoallw(domain, sendcounts.data(), displs.data(), sendtypes.data(),
+                  tile,   recvcounts.data(), displs.data(), recvtypes.data(),
+                  decomposition.cartComm);
+} // end of ScatterTiles
+//------------------------------------------------------------------------------
+
+/**
+ * Read the tile of every rank with halo zones from the material file. The
+ * file is opened by all ranks with the MPI-IO driver and every rank reads
+ * a hyperslab of the tile and its halos (clipped to the domain) of the
+ * initial temperature, domain parameters and domain map, so the domain is
+ * never held by a single rank.
+ * @param [in]  fileName      - material file
+ * @param [in]  decomposition - decomposition of the domain
+ * @param [in]  edgeSize      - size of the domain
+ * @param [out] tempTile      - local array of the initial temperature
+ * @param [out] paramsTile    - local array of the domain parameters
+ * @param [out] mapTile       - local array of the domain map
+ */
+void LoadMaterialTiles(const string         &fileName,
+                       const TDecomposition &decomposition,
+                       const size_t          edgeSize,
+                       float                *tempTile,
+                       float                *paramsTile,
+                       int                  *mapTile)
+{
+    // tile with halo zones clipped to the domain
+    hsize_t file_offset[2], block_dims[2], local_dims[2], local_offset[2];
+    GetTileHyperslab(decomposition, edgeSize, file_offset, block_dims, local_dims, local_offset);
+
+    // open the file with all processes
+    hid_t hPropList = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_mpio(hPropList, decomposition.cartComm, MPI_INFO_NULL);
+    hid_t file_id = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, hPropList);
+    H5Pclose(hPropList);
+    if (file_id < 0)
+    {
+        printf("ERROR: cannot open the material file %s\n", fileName.c_str());
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // block of the local array the hyperslab is read into
+    hid_t memspace_id = H5Screate_simple(2, local_dims, NULL);
+    H5Sselect_hyperslab(memspace_id, H5S_SELECT_SET, local_offset, NULL, block_dims, NULL);
+
+    // setup collective read using MPI parallel I/O
+    hid_t hXferList = H5Pcreate(H5P_DATASET_XFER);
+    H5Pset_dxpl_mpio(hXferList, H5FD_MPIO_COLLECTIVE);
+
+    const char  *datasetNames[3] = { "/InitialTemperature", "/DomainParameters", "/DomainMap" };
+    const hid_t  datasetTypes[3] = { H5T_NATIVE_FLOAT,      H5T_NATIVE_FLOAT,    H5T_NATIVE_INT };
+    void        *tiles[3]        = { tempTile,              paramsTile,          mapTile };
+
+    for (int d = 0; d < 3; d++)
+    {
+        hid_t dataset_id   = H5Dopen(file_id, datasetNames[d], H5P_DEFAULT);
+        hid_t dataspace_id = H5Dget_space(dataset_id);
+
+        H5Sselect_hyperslab(dataspace_id, H5S_SELECT_SET, file_offset, NULL, block_dims, NULL);
+        if (H5Dread(dataset_id, datasetTypes[d], memspace_id, dataspace_id, hXferList, tiles[d]) < 0)
+        {
+            printf("ERROR: cannot read %s from the material file %s\n", datasetNames[d], fileName.c_str());
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        H5Sclose(dataspace_id);
+        H5Dclose(dataset_id);
+    }
+
+    H5Pclose(hXferList);
+    H5Sclose(memspace_id);
+    H5Fclose(file_id);
+} // end of LoadMaterialTiles
+//------------------------------------------------------------------------------
+
+/**
+ * Get the hyperslab of the tile with halo zones clipped to the domain, both
+ * in the domain and in the local array with halo zones
+ * @param [in]  decomposition - decomposition of the domain
+ * @param [in]  edgeSize      - size of the domain
+ * @param [out] fileOffset    - start of the block in the domain
+ * @param [out] blockDims     - size of the block
+ * @param [out] localDims     - size of the local array with halo zones
+ * @param [out] localOffset   - start of the block in the local array
+ */
+void GetTileHyperslab(const TDecomposition &decomposition,
+                      const size_t          edgeSize,
+                      hsize_t               fileOffset[2],
+                      hsize_t               blockDims[2],
+                      hsize_t               localDims[2],
+                      hsize_t               localOffset[2])
+{
+    const hsize_t haloWidth  = decomposition.haloWidth;
+    const hsize_t tilePosY   = decomposition.tilePosY;
+    const hsize_t tilePosX   = decomposition.tilePosX;
+
+    const hsize_t startY = (tilePosY > haloWidth) ? tilePosY - haloWidth : 0;
+    const hsize_t startX = (tilePosX > haloWidth) ? tilePosX - haloWidth : 0;
+    const hsize_t endY   = min<hsize_t>(tilePosY + decomposition.tileHeight + haloWidth, edgeSize);
+    const hsize_t endX   = min<hsize_t>(tilePosX + decomposition.tileWidth  + haloWidth, edgeSize);
+
+    fileOffset[0]  = startY;
+    fileOffset[1]  = startX;
+    blockDims[0]   = endY - startY;
+    blockDims[1]   = endX - startX;
+    localDims[0]   = decomposition.tileHeight + 2 * haloWidth;
+    localDims[1]   = decomposition.tileWidth  + 2 * haloWidth;
+    localOffset[0] = startY + haloWidth - tilePosY;
+    localOffset[1] = startX + haloWidth - tilePosX;
+} // end of GetTileHyperslab
+//------------------------------------------------------------------------------
+
+/**
+ * Write the tiles of all ranks (without halo zones) collectively into the
+ * global temperature dataset of a checkpoint file together with the next
+ * iteration and the size of the domain. The checkpoint is written into a
+ * temporary file renamed when complete, so a job killed while writing keeps
+ * the previous checkpoint.
+ * @param [in] fileName      - checkpoint file
+ * @param [in] tile          - local array with halo zones
+ * @param [in] decomposition - decomposition of the domain
+ * @param [in] edgeSize      - size of the domain
+ * @param [in] nextIteration - first iteration of the restarted simulation
+ */
+void StoreCheckpoint(const string         &fileName,
+                     const float          *tile,
+                     const TDecomposition &decomposition,
+                     const size_t          edgeSize,
+                     const size_t          nextIteration)
+{
+    int rank;
+    MPI_Comm_rank(decomposition.cartComm, &rank);
+
+    const string tmpFileName = fileName + ".tmp";
+
+    // create the file with all processes
+    hid_t hPropList = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_mpio(hPropList, decomposition.cartComm, MPI_INFO_NULL);
+    hid_t file_id = H5Fcreate(tmpFileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, hPropList);
+    H5Pclose(hPropList);
+    if (file_id < 0)
+    {
+        printf("ERROR: cannot create the checkpoint file %s\n", tmpFileName.c_str());
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    hid_t hXferList = H5Pcreate(H5P_DATASET_XFER);
+    H5Pset_dxpl_mpio(hXferList, H5FD_MPIO_COLLECTIVE);
+
+    // tile without halo zones into the global dataset
+    const hsize_t dims[2]         = { edgeSize, edgeSize };
+    const hsize_t haloWidth       = decomposition.haloWidth;
+    const hsize_t tile_dims[2]    = { decomposition.tileHeight, decomposition.tileWidth };
+    const hsize_t file_offset[2]  = { decomposition.tilePosY, decomposition.tilePosX };
+    const hsize_t local_dims[2]   = { decomposition.tileHeight + 2 * haloWidth, decomposition.tileWidth + 2 * haloWidth };
+    const hsize_t local_offset[2] = { haloWidth, haloWidth };
+
+    hid_t dataspace_id = H5Screate_simple(2, dims, NULL);
+    hid_t dataset_id   = H5Dcreate(file_id, "/Temperature", H5T_NATIVE_FLOAT, dataspace_id,
+                                   H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    hid_t memspace_id  = H5Screate_simple(2, local_dims, NULL);
+    H5Sselect_hyperslab(dataspace_id, H5S_SELECT_SET, file_offset,  NULL, tile_dims, NULL);
+    H5Sselect_hyperslab(memspace_id,  H5S_SELECT_SET, local_offset, NULL, tile_dims, NULL);
+    H5Dwrite(dataset_id, H5T_NATIVE_FLOAT, memspace_id, dataspace_id, hXferList, tile);
+    H5Sclose(memspace_id);
+    H5Sclose(dataspace_id);
+    H5Dclose(dataset_id);
+
+    // scalars written by rank 0 only
+    const char              *scalarNames[2]  = { "/Iteration",   "/EdgeSize" };
+    const unsigned long long scalarValues[2] = { nextIteration, edgeSize };
+    for (int s = 0; s < 2; s++)
+    {
+        dataspace_id = H5Screate(H5S_SCALAR);
+        dataset_id   = H5Dcreate(file_id, scalarNames[s], H5T_NATIVE_ULLONG, dataspace_id,
+                                 H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        memspace_id  = H5Screate(H5S_SCALAR);
+        if (rank != 0)
+        {
+            H5Sselect_none(dataspace_id);
+            H5Sselect_none(memspace_id);
+        }
+        H5Dwrite(dataset_id, H5T_NATIVE_ULLONG, memspace_id, dataspace_id, hXferList, &scalarValues[s]);
+        H5Sclose(memspace_id);
+        H5Sclose(dataspace_id);
+        H5Dclose(dataset_id);
+    }
+
+    H5Pclose(hXferList);
+    H5Fclose(file_id);
+
+    // the file is complete on all processes once closed collectively
+    if (rank == 0)
+    {
+        if (rename(tmpFileName.c_str(), fileName.c_str()) != 0)
+        {
+            printf("ERROR: cannot rename the checkpoint file %s\n", tmpFileName.c_str());
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+} // end of StoreCheckpoint
+//------------------------------------------------------------------------------
+
+/**
+ * Read the tile with halo zones (clipped to the domain) from the global
+ * temperature dataset of a checkpoint file. The dataset does not depend on
+ * the decomposition, so the checkpoint may come from any number of ranks.
+ * @param [in]  fileName      - checkpoint file
+ * @param [in]  decomposition - decomposition of the domain
+ * @param [in]  edgeSize      - size of the domain
+ * @param [out] tile          - local array with halo zones
+ * @return first iteration of the restarted simulation
+ */
+size_t LoadCheckpointTile(const string         &fileName,
+                          const TDecomposition &decomposition,
+                          const size_t          edgeSize,
+                          float                *tile)
+{
+    hsize_t file_offset[2], block_dims[2], local_dims[2], local_offset[2];
+    GetTileHyperslab(decomposition, edgeSize, file_offset, block_dims, local_dims, local_offset);
+
+    // open the file with all processes
+    hid_t hPropList = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_mpio(hPropList, decomposition.cartComm, MPI_INFO_NULL);
+    hid_t file_id = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, hPropList);
+    H5Pclose(hPropList);
+    if (file_id < 0)
+    {
+        printf("ERROR: cannot open the checkpoint file %s\n", fileName.c_str());
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    unsigned long long nextIteration = 0, checkpointEdgeSize = 0;
+    hid_t dataset_id = H5Dopen(file_id, "/EdgeSize", H5P_DEFAULT);
+    H5Dread(dataset_id, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, &checkpointEdgeSize);
+    H5Dclose(dataset_id);
+    dataset_id = H5Dopen(file_id, "/Iteration", H5P_DEFAULT);
+    H5Dread(dataset_id, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, &nextIteration);
+    H5Dclose(dataset_id);
+
+    if (checkpointEdgeSize != edgeSize)
+    {
+        printf("ERROR: the checkpoint %s is of a domain of %llu, not %zu\n",
+               fileName.c_str(), checkpointEdgeSize, edgeSize);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // setup collective read using MPI parallel I/O
+    hid_t hXferList = H5Pcreate(H5P_DATASET_XFER);
+    H5Pset_dxpl_mpio(hXferList, H5FD_MPIO_COLLECTIVE);
+
+    dataset_id = H5Dopen(file_id, "/Temperature", H5P_DEFAULT);
+    hid_t dataspace_id = H5Dget_space(dataset_id);
+    hid_t memspace_id  = H5Screate_simple(2, local_dims, NULL);
+    H5Sselect_hyperslab(dataspace_id, H5S_SELECT_SET, file_offset,  NULL, block_dims, NULL);
+    H5Sselect_hyperslab(memspace_id,  H5S_SELECT_SET, local_offset, NULL, block_dims, NULL);
+    if (H5Dread(dataset_id, H5T_NATIVE_FLOAT, memspace_id, dataspace_id, hXferList, tile) < 0)
+    {
+        printf("ERROR: cannot read the temperature from the checkpoint file %s\n", fileName.c_str());
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    H5Sclose(memspace_id);
+    H5Sclose(dataspace_id);
+    H5Dclose(dataset_id);
+    H5Pclose(hXferList);
+    H5Fclose(file_id);
+
+    return nextIteration;
+} // end of LoadCheckpointTile
+//------------------------------------------------------------------------------
+
+/**
+ * Gather the tiles into the domain on rank 0 (reverse of ScatterTiles)
+ * @param [in]  tile          - local array with halo zones
+ * @param [out] domain        - whole domain (rank 0 only)
+ * @param [in]  tileTypes     - datatypes of the tiles
+ * @param [in]  decomposition - decomposition of the domain
+ */
+void GatherTiles(const void           *tile,
+                 void                 *domain,
+                 const TTileTypes     &tileTypes,
+                 const TDecomposition &decomposition)
+{
+    int rank, size;
+    MPI_Comm_rank(decomposition.cartComm, &rank);
+    MPI_Comm_size(decomposition.cartComm, &size);
+
+    vector<int>          sendcounts(size, 0), recvcounts(size, 0), displs(size, 0);
+    vector<MPI_Datatype> sendtypes(size, tileTypes.elementType), recvtypes(size, tileTypes.elementType);
+
+    sendcounts[0] = 1;
+    sendtypes[0]  = tileTypes.tileType;
+    if (rank == 0)
+    {
+        for (int r = 0; r < size; r++)
+        {
+            recvcounts[r] = 1;
+            recvtypes[r]  = tileTypes.domainTileTypes[r];
+        }
+    }
+
+    MPI_Alltoallw(tile,   sendcounts.data(), displs.data(), sendtypes.data(),
+                  domain, recvcounts.data(), displs.data(), recvtypes.data(),
+                  decomposition.cartComm);
+} // end of GatherTiles
+//------------------------------------------------------------------------------
+
+/**
+ * Hand the tile over to its I/O server. The tile is copied into a free slot
+ * and sent without waiting, the compute rank waits only if all its slots
+ * are still on the way (the server is behind by IO_BUFFER_SLOTS snapshots).
+ * @param [in]      tile          - local array with halo zones
+ * @param [in]      decomposition - decomposition of the domain
+ * @param [in]      snapshotId    - snapshot id
+ * @param [in, out] slots         - IO_BUFFER_SLOTS buffers of the size of the tile
+ * @param [in, out] requests      - sends of the slots
+ */
+void SendSnapshotTile(const float          *tile,
+                      const TDecomposition &decomposition,
+                      const size_t          snapshotId,
+                      float                *slots,
+                      MPI_Request          *requests)
+{
+    const size_t tileWidth  = decomposition.tileWidth;
+    const size_t tileHeight = decomposition.tileHeight;
+    const size_t haloWidth  = decomposition.haloWidth;
+    const size_t rowSize    = tileWidth + 2 * haloWidth;
+
+    const int slot = snapshotId % IO_BUFFER_SLOTS;
+    float *buffer  = slots + slot * tileWidth * tileHeight;
+
+    // back-pressure, the slot is free once the server has received its previous snapshot
+    MPI_Wait(&requests[slot], MPI_STATUS_IGNORE);
+
+    for (size_t i = 0; i < tileHeight; i++)
+    {
+        memcpy(buffer + i * tileWidth, tile + (i + haloWidth) * rowSize + haloWidth, tileWidth * sizeof(float));
+    }
+
+    // compute ranks are spread round-robin over the servers
+    int rank;
+    MPI_Comm_rank(decomposition.cartComm, &rank);
+    const int server = ioServers.nComputeRanks + rank % ioServers.nServers;
+
+    MPI_Isend(buffer, tileWidth * tileHeight, MPI_FLOAT, server, TAG_SNAPSHOT, MPI_COMM_WORLD, &requests[slot]);
+} // end of SendSnapshotTile
+//------------------------------------------------------------------------------
+
+/**
+ * Receive the tiles of the compute ranks and write snapshots. Every server
+ * serves every nServers-th compute rank, the tiles are known from the same
+ * grid as in CreateDecomposition. The server holds IO_BUFFER_SLOTS snapshots,
+ * the next ones are received while the current one is written. One server
+ * writes by serial HDF5, more of them share the file by parallel HDF5.
+ * A restarted simulation continues the existing file from the snapshot of
+ * the checkpoint iteration (sent by the compute rank 0).
+ * @param [in] parameters     - parameters of the simulation
+ * @param [in] edgeSize       - size of the domain
+ * @param [in] outputFileName - output file name (if NULL string, do not store)
+ */
+void RunIOServer(const TParameters &parameters,
+                 const size_t       edgeSize,
+                 string             outputFileName)
+{
+    if (outputFileName == "") return;
+
+    int serverRank;
+    MPI_Comm_rank(ioServers.serverComm, &serverRank);
+
+    if (outputFileName.find(".h5") == string::npos)
+        outputFileName.append("_par.h5");
+    else
+        outputFileName.insert(outputFileName.find_last_of("."), "_par");
+
+    // restarted compute ranks send snapshots from the iteration of the checkpoint on
+    const bool restart = (extParameters.restartFileName != "");
+    unsigned long long startIteration = 0;
+    if (restart)
+    {
+        MPI_Bcast(&startIteration, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    }
+
+    hid_t file_id;
+    if (!parameters.useParallelIO)
+    {
+        file_id = OpenOutputFile(outputFileName, H5P_DEFAULT, restart);
+    }
+    else
+    {
+        hid_t hPropList = H5Pcreate(H5P_FILE_ACCESS);
+        H5Pset_fapl_mpio(hPropList, ioServers.serverComm, MPI_INFO_NULL);
+        file_id = OpenOutputFile(outputFileName, hPropList, restart);
+        H5Pclose(hPropList);
+    }
+    if (file_id < 0) ios::failure("Cannot create output file");
+
+    // tiles of the served compute ranks (the Cartesian grid keeps their order)
+    int dims[2];
+    GetDecompositionDims(ioServers.nComputeRanks, dims);
+
+    vector<TServerTile> tiles;
+    size_t bufferSize = 0;
+    for (int r = serverRank; r < ioServers.nComputeRanks; r += ioServers.nServers)
+    {
+        TServerTile tile;
+        tile.rank = r;
+        GetBlockRange(edgeSize, dims[0], r / dims[1], tile.posY, tile.height);
+        GetBlockRange(edgeSize, dims[1], r % dims[1], tile.posX, tile.width);
+        tile.offset = bufferSize;
+
+        bufferSize += tile.height * tile.width;
+        tiles.push_back(tile);
+    }
+
+    // snapshots of ParallelHeatDistribution (iterations startIteration .. nIterations - 2)
+    const size_t firstSnapshot = (startIteration + parameters.diskWriteIntensity - 1) / parameters.diskWriteIntensity;
+    const size_t endSnapshot   = (parameters.nIterations < 2)
+                                 ? 0 : (parameters.nIterations - 2) / parameters.diskWriteIntensity + 1;
+    const size_t nSnapshots    = (endSnapshot > firstSnapshot) ? endSnapshot - firstSnapshot : 0;
+
+    // the interrupted run may have written the snapshots after the checkpoint
+    if (restart && file_id >= 0)
+    {
+        RemoveSnapshots(file_id, firstSnapshot);
+    }
+
+    vector<float>       buffers(IO_BUFFER_SLOTS * bufferSize);
+    vector<MPI_Request> requests(IO_BUFFER_SLOTS * tiles.size(), MPI_REQUEST_NULL);
+    vector<float>       domain((parameters.useParallelIO) ? 0 : edgeSize * edgeSize);
+
+    for (size_t snapshot = 0; snapshot < min<size_t>(nSnapshots, IO_BUFFER_SLOTS); snapshot++)
+    {
+        PostSnapshotReceives(tiles, &buffers[snapshot * bufferSize], &requests[snapshot * tiles.size()]);
+    }
+
+    for (size_t snapshot = 0; snapshot < nSnapshots; snapshot++)
+    {
+        const size_t slot   = snapshot % IO_BUFFER_SLOTS;
+        float       *buffer = &buffers[slot * bufferSize];
+
+        MPI_Waitall(tiles.size(), &requests[slot * tiles.size()], MPI_STATUSES_IGNORE);
+
+        if (file_id >= 0)
+        {
+            if (!parameters.useParallelIO)
+            {
+                // assemble the domain
+                for (size_t t = 0; t < tiles.size(); t++)
+                    for (size_t i = 0; i < tiles[t].height; i++)
+                        memcpy(&domain[(tiles[t].posY + i) * edgeSize + tiles[t].posX],
+                               buffer + tiles[t].offset + i * tiles[t].width,
+                               tiles[t].width * sizeof(float));
+
+                StoreDataIntoFile(file_id, domain.data(), edgeSize,
+                                  firstSnapshot + snapshot, (firstSnapshot + snapshot) * parameters.diskWriteIntensity);
+            }
+            else
+            {
+                StoreTilesIntoFileParallel(file_id, buffer, edgeSize, tiles,
+                                           firstSnapshot + snapshot, (firstSnapshot + snapshot) * parameters.diskWriteIntensity);
+            }
+        }
+
+        // the slot is written, receive a later snapshot into it
+        if (snapshot + IO_BUFFER_SLOTS < nSnapshots)
+        {
+            PostSnapshotReceives(tiles, buffer, &requests[slot * tiles.size()]);
+        }
+    }
+
+    if (file_id >= 0) H5Fclose(file_id);
+} // end of RunIOServer
+//------------------------------------------------------------------------------
+
+/**
+ * Post receives of one snapshot of the tiles of an I/O server
+ * @param [in]  tiles    - tiles of the server
+ * @param [out] buffer   - snapshot buffer
+ * @param [out] requests - one receive per tile
+ */
+void PostSnapshotReceives(const vector<TServerTile> &tiles,
+                          float                     *buffer,
+                          MPI_Request               *requests)
+{
+    for (size_t t = 0; t < tiles.size(); t++)
+    {
+        MPI_Irecv(buffer + tiles[t].offset, tiles[t].height * tiles[t].width, MPI_FLOAT,
+                  tiles[t].rank, TAG_SNAPSHOT, MPI_COMM_WORLD, &requests[t]);
+    }
+} // end of PostSnapshotReceives
+//------------------------------------------------------------------------------
+
+/**
+ * Gather the phase times of all ranks to rank 0, print the minimum, average
+ * and maximum of every phase with the imbalance ratio (maximum / average)
+ * and the achieved overlap of the halo exchange, the part of the time the
+ * exchange was in flight hidden behind the interior, and optionally write
+ * the times of every rank into a CSV file.
+ * @param [in] phaseTimes   - time of every phase on this rank [s]
+ * @param [in] haloInFlight - time from posting the halo exchange to the arrival of all halos [s]
+ * @param [in] haloExposed  - time spent waiting for the halos [s]
+ * @param [in] comm         - communicator of the compute ranks
+ * @param [in] printReport  - print the summary
+ * @param [in] csvFileName  - CSV file with one line per rank, empty for none
+ */
+void ReportPhaseTimes(const double  phaseTimes[N_PHASES],
+                      const double  haloInFlight,
+                      const double  haloExposed,
+                      MPI_Comm      comm,
+                      const bool    printReport,
+                      const string &csvFileName)
+{
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    //Phases followed by the overlap of the halo exchange
+    const int nTimes = N_PHASES + 1;
+    vector<double> times(phaseTimes, phaseTimes + N_PHASES);
+    times.push_back((haloInFlight > 0.0) ? max(0.0, 1.0 - haloExposed / haloInFlight) : 1.0);
+
+    vector<double> allTimes((rank == 0) ? size * nTimes : 0);
+    MPI_Gather(times.data(), nTimes, MPI_DOUBLE, allTimes.data(), nTimes, MPI_DOUBLE, 0, comm);
+
+    if (rank != 0) return;
+
+    if (printReport)
+    {
+        printf("\nPhase times of %d ranks [s]\n", size);
+        printf("%-10s %12s %12s %12s %10s\n", "phase", "min", "avg", "max", "max/avg");
+        for (int phase = 0; phase < N_PHASES; phase++)
+        {
+            double minTime = allTimes[phase];
+            double maxTime = allTimes[phase];
+            double sumTime = 0.0;
+            for (int r = 0; r < size; r++)
+            {
+                minTime  = min(minTime, allTimes[r * nTimes + phase]);
+                maxTime  = max(maxTime, allTimes[r * nTimes + phase]);
+                sumTime += allTimes[r * nTimes + phase];
+            }
+            const double avgTime = sumTime / size;
+
+            printf("%-10s %12.5f %12.5f %12.5f %10.3f\n", phaseNames[phase], minTime, avgTime, maxTime,
+                   (avgTime > 0.0) ? maxTime / avgTime : 1.0);
+        }
+
+        double minOverlap = allTimes[N_PHASES];
+        double maxOverlap = allTimes[N_PHASES];
+        double sumOverlap = 0.0;
+        for (int r = 0; r < size; r++)
+        {
+            minOverlap  = min(minOverlap, allTimes[r * nTimes + N_PHASES]);
+            maxOverlap  = max(maxOverlap, allTimes[r * nTimes + N_PHASES]);
+            sumOverlap += allTimes[r * nTimes + N_PHASES];
+        }
+        printf("%-10s %11.1f%% %11.1f%% %11.1f%%\n", "overlap", 100.0 * minOverlap, 100.0 * sumOverlap / size,
+               100.0 * maxOverlap);
+    }
+
+    if (csvFileName != "")
+    {
+        FILE *csvFile = fopen(csvFileName.c_str(), "w");
+        if (csvFile == NULL)
+        {
+            printf("ERROR: Cannot create the timing file %s\n", csvFileName.c_str());
+            return;
+        }
+
+        fprintf(csvFile, "rank");
+        for (int phase = 0; phase < N_PHASES; phase++)
+            fprintf(csvFile, ";%s", phaseNames[phase]);
+        fprintf(csvFile, ";overlap\n");
+
+        for (int r = 0; r < size; r++)
+        {
+            fprintf(csvFile, "%d", r);
+            for (int t = 0; t < nTimes; t++)
+                fprintf(csvFile, ";%e", allTimes[r * nTimes + t]);
+            fprintf(csvFile, "\n");
+        }
+        fclose(csvFile);
+    }
+} // end of ReportPhaseTimes
+//------------------------------------------------------------------------------
+
+/**
+ * Parse extended parameters (long options) and remove them from argv, so
+ * the rest can be processed by ParseCommandline
+ *   --halo <p2p|neighbor|shm|rma> - halo exchange by persistent point-to-point
+ *                           requests, by a neighbourhood collective (default),
+ *                           through shared memory within a node or by
+ *                           one-sided puts (post/start/complete/wait)
+ *   --halo-depth <k|auto> - halos 2k wide exchanged once per k iterations
+ *                           (neighbourhood collective only), auto selects k
+ *                           from the measured latency and computation
+ *   --load <root|parallel>  - material loaded by rank 0 and scattered (default)
+ *                           or read tile by tile by all ranks (parallel HDF5)
+ *   --io-servers <n>        - the last n ranks only write snapshots sent by
+ *                           the compute ranks (more than one requires -p)
+ *   --layout <contiguous|chunked> - parallel output into a contiguous dataset
+ *                           (default) or into chunks of the size of a tile
+ *   --alignment <bytes>     - alignment of chunks (file system stripe, 1 MiB),
+ *                           chunked layout only
+ *   --write <collective|independent> - kind of the parallel write
+ *   --cb-buffer <bytes>     - cb_buffer_size hint of collective buffering
+ *   --timing-csv <file>     - phase times of every rank into a CSV file
+ *   --generate-material <file> <edge> - only write a synthetic material file
+ *                           of the given size (benchmarks)
+ *   --checkpoint <file>     - write a checkpoint of the parallel version
+ *   --checkpoint-interval <n> - iterations between checkpoints (1000)
+ *   --restart <file>        - continue the parallel version from a checkpoint
+ *                           written by any number of ranks
+ *   --progress-chunk <rows> - interior rows computed between two tests of the
+ *                           halo exchange (4)
+ *   --progress-thread       - the master thread only progresses the halo
+ *                           exchange until it completes (requires -t > 1)
+ *   --decomposition <tiles|strips|auto> - 2D tiles (default), strips of whole
+ *                           rows with contiguous halos, or selected by the
+ *                           measured latency and bandwidth
+ *   --pack-columns          - left and right halos packed into contiguous
+ *                           buffers by SSE (p2p and shm exchange only)
+ *   --halo-fp16             - halos sent in half precision, -v reports the
+ *                           error against the sequential version (p2p and
+ *                           shm exchange only)
+ * @param [in, out] argc
+ * @param [in, out] argv
+ * @param [out]     extParameters - extended parameters of the simulation
+ */
+void ParseExtendedCommandline(int                 &argc,
+                              char                *argv[],
+                              TExtendedParameters &extParameters)
+{
+    int nArgs = 1;
+    bool alignmentGiven = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const string option = argv[i];
+
+        if (option == "--halo")
+        {
+            const string mode = (i + 1 < argc) ? argv[++i] : "";
+
+            if (mode == "p2p")
+                extParameters.haloExchange = HALO_P2P;
+            else if (mode == "neighbor")
+                extParameters.haloExchange = HALO_NEIGHBOR;
+            else if (mode == "shm")
+                extParameters.haloExchange = HALO_SHM;
+            else if (mode == "rma")
+                extParameters.haloExchange = HALO_RMA;
+            else
+            {
+                fprintf(stderr, "[ERROR]: --halo requires p2p, neighbor, shm or rma.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (option == "--load")
+        {
+            const string mode = (i + 1 < argc) ? argv[++i] : "";
+
+            if (mode == "root")
+                extParameters.materialLoading = LOAD_ROOT;
+            else if (mode == "parallel")
+                extParameters.materialLoading = LOAD_PARALLEL;
+            else
+            {
+                fprintf(stderr, "[ERROR]: --load requires root or parallel.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (option == "--io-servers")
+        {
+            extParameters.nIOServers = (i + 1 < argc) ? atoi(argv[++i]) : -1;
+            if (extParameters.nIOServers < 0)
+            {
+                fprintf(stderr, "[ERROR]: --io-servers requires a non-negative number.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (option == "--layout")
+        {
+            const string layout = (i + 1 < argc) ? argv[++i] : "";
+
+            if (layout == "contiguous")
+                extParameters.chunkedOutput = false;
+            else if (layout == "chunked")
+                extParameters.chunkedOutput = true;
+            else
+            {
+                fprintf(stderr, "[ERROR]: --layout requires contiguous or chunked.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (option == "--alignment")
+        {
+            const long alignment = (i + 1 < argc) ? atol(argv[++i]) : 0;
+            if (alignment < 1)
+            {
+                fprintf(stderr, "[ERROR]: --alignment requires a positive number of bytes.\n");
+                exit(EXIT_FAILURE);
+            }
+            extParameters.outputAlignment = alignment;
+            alignmentGiven = true;
+        }
+        else if (option == "--write")
+        {
+            const string write = (i + 1 < argc) ? argv[++i] : "";
+
+            if (write == "collective")
+                extParameters.independentWrite = false;
+            else if (write == "independent")
+                extParameters.independentWrite = true;
+            else
+            {
+                fprintf(stderr, "[ERROR]: --write requires collective or independent.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (option == "--cb-buffer")
+        {
+            const long cbBufferSize = (i + 1 < argc) ? atol(argv[++i]) : 0;
+            if (cbBufferSize < 1)
+            {
+                fprintf(stderr, "[ERROR]: --cb-buffer requires a positive number of bytes.\n");
+                exit(EXIT_FAILURE);
+            }
+            extParameters.cbBufferSize = cbBufferSize;
+        }
+        else if (option == "--generate-material")
+        {
+            extParameters.generatedFileName = (i + 1 < argc) ? argv[++i] : "";
+            const long edgeSize = (i + 1 < argc) ? atol(argv[++i]) : 0;
+            if ((extParameters.generatedFileName == "") || (edgeSize < MIN_TILE_SIZE))
+            {
+                fprintf(stderr, "[ERROR]: --generate-material requires a file name and an edge size of at least %d.\n",
+                        MIN_TILE_SIZE);
+                exit(EXIT_FAILURE);
+            }
+            extParameters.generatedEdgeSize = edgeSize;
+        }
+        else if ((option == "--checkpoint") || (option == "--restart"))
+        {
+            const string fileName = (i + 1 < argc) ? argv[++i] : "";
+            if (fileName == "")
+            {
+                fprintf(stderr, "[ERROR]: %s requires a file name.\n", option.c_str());
+                exit(EXIT_FAILURE);
+            }
+            if (option == "--checkpoint")
+                extParameters.checkpointFileName = fileName;
+            else
+                extParameters.restartFileName = fileName;
+        }
+        else if (option == "--progress-chunk")
+        {
+            extParameters.progressChunk = (i + 1 < argc) ? atoi(argv[++i]) : 0;
+            if (extParameters.progressChunk < 1)
+            {
+                fprintf(stderr, "[ERROR]: --progress-chunk requires a positive number of rows.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (option == "--decomposition")
+        {
+            const string layout = (i + 1 < argc) ? argv[++i] : "";
+
+            if (layout == "tiles")
+                extParameters.decompositionLayout = LAYOUT_TILES;
+            else if (layout == "strips")
+                extParameters.decompositionLayout = LAYOUT_STRIPS;
+            else if (layout == "auto")
+                extParameters.decompositionLayout = LAYOUT_AUTO;
+            else
+            {
+                fprintf(stderr, "[ERROR]: --decomposition requires tiles, strips or auto.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (option == "--pack-columns")
+        {
+            extParameters.packColumns = true;
+        }
+        else if (option == "--halo-fp16")
+        {
+            extParameters.halfHalos = true;
+        }
+        else if (option == "--progress-thread")
+        {
+            extParameters.progressThread = true;
+        }
+        else if (option == "--checkpoint-interval")
+        {
+            const long interval = (i + 1 < argc) ? atol(argv[++i]) : 0;
+            if (interval < 1)
+            {
+                fprintf(stderr, "[ERROR]: --checkpoint-interval requires a positive number.\n");
+                exit(EXIT_FAILURE);
+            }
+            extParameters.checkpointInterval = interval;
+        }
+        else if (option == "--timing-csv")
+        {
+            extParameters.timingFileName = (i + 1 < argc) ? argv[++i] : "";
+            if (extParameters.timingFileName == "")
+            {
+                fprintf(stderr, "[ERROR]: --timing-csv requires a file name.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (option == "--halo-depth")
+        {
+            const string depth = (i + 1 < argc) ? argv[++i] : "";
+
+            extParameters.haloDepth = (depth == "auto") ? 0 : atoi(depth.c_str());
+            if ((depth != "auto") && (extParameters.haloDepth < 1))
+            {
+                fprintf(stderr, "[ERROR]: --halo-depth requires a positive number or auto.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else
+        {
+            // keep the option for ParseCommandline
+            argv[nArgs++] = argv[i];
+        }
+    }
+
+    argv[nArgs] = NULL;
+    argc = nArgs;
+
+    // only chunks are aligned, the contiguous dataset would ignore it
+    if (alignmentGiven && !extParameters.chunkedOutput)
+    {
+        fprintf(stderr, "[ERROR]: --alignment requires --layout chunked.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // persistent requests are set up for two wide halos only
+    if ((extParameters.haloExchange != HALO_NEIGHBOR) && (extParameters.haloDepth != 1))
+    {
+        fprintf(stderr, "[ERROR]: --halo-depth requires --halo neighbor.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // packed columns are sent by the persistent requests
+    if (extParameters.packColumns && (extParameters.haloExchange != HALO_P2P) && (extParameters.haloExchange != HALO_SHM))
+    {
+        fprintf(stderr, "[ERROR]: --pack-columns requires --halo p2p or shm.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // half precision halos are converted into the buffers of the persistent requests
+    if (extParameters.halfHalos && (extParameters.haloExchange != HALO_P2P) && (extParameters.haloExchange != HALO_SHM))
+    {
+        fprintf(stderr, "[ERROR]: --halo-fp16 requires --halo p2p or shm.\n");
+        exit(EXIT_FAILURE);
+    }
+} // end of ParseExtendedCommandline
+//------------------------------------------------------------------------------
+
+/**
+ * Main function of the project
+ * @param [in] argc
+ * @param [in] argv
+ * @return
+ */
+int main(int argc, char *argv[])
+{
+    int rank, size;
+
+    ParseExtendedCommandline(argc, argv, extParameters);
+
+    // Benchmarks generate their material files without MPI
+    if (extParameters.generatedFileName != "")
+    {
+        GenerateMaterialFile(extParameters.generatedFileName, extParameters.generatedEdgeSize);
+        return EXIT_SUCCESS;
+    }
+
+    ParseCommandline(argc, argv, parameters);
+
+    // The progress thread is the master thread of the team, the others compute
+    if (extParameters.progressThread && (parameters.nThreads < 2))
+    {
+        fprintf(stderr, "[ERROR]: --progress-thread requires at least two threads (-t).\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initialize MPI, only the master thread of a rank calls MPI in the hybrid mode
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    // Get MPI rank and size
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if ((parameters.nThreads > 1) && (provided < MPI_THREAD_FUNNELED))
+    {
+        if (rank == 0)
+            printf("ERROR: the MPI library does not support MPI_THREAD_FUNNELED needed by -t\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Reserve the last ranks as I/O servers, the rest computes
+    ioServers.nServers      = extParameters.nIOServers;
+    ioServers.nComputeRanks = size - ioServers.nServers;
+    if (ioServers.nComputeRanks < 1)
+    {
+        if (rank == 0)
+            printf("ERROR: %d I/O servers leave no compute ranks\n", ioServers.nServers);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if ((ioServers.nServers > 1) && !parameters.useParallelIO)
+    {
+        if (rank == 0)
+            printf("ERROR: more than one I/O server requires parallel I/O (-p)\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    const bool ioServer = (rank >= ioServers.nComputeRanks);
+    MPI_Comm splitComm;
+    MPI_Comm_split(MPI_COMM_WORLD, ioServer ? 1 : 0, rank, &splitComm);
+    ioServers.computeComm = ioServer ? MPI_COMM_NULL : splitComm;
+    ioServers.serverComm  = ioServer ? splitComm : MPI_COMM_NULL;
+
+
+    if (rank == 0)
+    {
+        // Create material properties and load from file, with parallel loading
+        // the whole domain is needed by the sequential version only
+        const bool loadAll = (extParameters.materialLoading == LOAD_ROOT) || parameters.IsRunSequntial();
+        materialProperties.LoadMaterialData(parameters.materialFileName, loadAll);
+        parameters.edgeSize = materialProperties.edgeSize;
+
+        parameters.PrintParameters();
+    }
+    else
+    {
+        // Create material properties and load from file
+        materialProperties.LoadMaterialData(parameters.materialFileName, false);
+        parameters.edgeSize = materialProperties.edgeSize;
+    }
+
+    // Strips or tiles, the compute ranks measure the network, the I/O servers follow rank 0
+    if (extParameters.decompositionLayout == LAYOUT_AUTO)
+    {
+        int strips = 0;
+        if (!ioServer && parameters.IsRunParallel())
+            strips = SelectStripDecomposition(ioServers.computeComm, parameters.edgeSize);
+        MPI_Bcast(&strips, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+        extParameters.decompositionLayout = strips ? LAYOUT_STRIPS : LAYOUT_TILES;
+        if ((rank == 0) && !parameters.batchMode && parameters.IsRunParallel())
+            printf("Decomposition into %s (auto)\n", strips ? "strips" : "tiles");
+    }
+
+    // Any number of processes is fine as long as every tile covers the halo zones
+    int dims[2];
+    GetDecompositionDims(ioServers.nComputeRanks, dims);
+    if (parameters.edgeSize / max(dims[0], dims[1]) < MIN_TILE_SIZE)
+    {
+        if (rank == 0)
+            printf("ERROR: the domain is too small for %d MPI processes (%d x %d tiles)\n",
+                   ioServers.nComputeRanks, dims[0], dims[1]);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    // Boundary strips of deep halos have to fit into the tile as well
+    if (parameters.edgeSize / max(dims[0], dims[1]) < 4 * (size_t) extParameters.haloDepth)
+    {
+        if (rank == 0)
+            printf("ERROR: tiles of %d x %d processes are too small for halo depth %d\n",
+                   dims[0], dims[1], extParameters.haloDepth);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (parameters.IsRunSequntial())
+    {
+        if (rank == 0)
+        {
+            // Memory allocation for output matrices.
+            seqResult = (float*)_mm_malloc(materialProperties.nGridPoints * sizeof(float), DATA_ALIGNMENT);
+
+            SequentialHeatDistribution(seqResult,
+                                       materialProperties,
+                                       parameters,
+                                       parameters.outputFileName);
+        }
+    }
+
+    if (parameters.IsRunParallel())
+    {
+        // Memory allocation for output matrix.
+        if (rank == 0)
+            parResult = (float*) _mm_malloc(materialProperties.nGridPoints * sizeof(float), DATA_ALIGNMENT);
+        else
+            parResult = NULL;
+
+        if (ioServer)
+        {
+            RunIOServer(parameters, materialProperties.edgeSize, parameters.outputFileName);
+        }
+        else
+        {
+            ParallelHeatDistribution(parResult,
+                                     materialProperties,
+                                     parameters,
+                                     parameters.outputFileName);
+        }
+    }
+
+    // Validate the outputs
+    if (parameters.IsValidation() && rank == 0)
+    {
+        if (parameters.debugFlag)
+        {
+            printf("---------------- Sequential results ---------------\n");
+            PrintArray(seqResult, materialProperties.edgeSize);
+
+            printf("----------------- Parallel results ----------------\n");
+            PrintArray(parResult, materialProperties.edgeSize);
+        }
+
+        // Error introduced by the rounding of the halos, it accumulates over the
+        // exchanges, the verdict keeps the tolerance of the fp32 halos
+        if (extParameters.halfHalos)
+        {
+            double maxError = 0.0, maxRelativeError = 0.0;
+            for (size_t i = 0; i < materialProperties.nGridPoints; i++)
+            {
+                const double error = fabs(double(parResult[i]) - double(seqResult[i]));
+                maxError = max(maxError, error);
+                if (seqResult[i] != 0.0f)
+                    maxRelativeError = max(maxRelativeError, error / fabs(double(seqResult[i])));
+            }
+            printf("Halo fp16 error: max absolute %e, max relative %e\n", maxError, maxRelativeError);
         }
 
         if (VerifyResults(seqResult, parResult, parameters, 0.001f))
@@ -1121,6 +4327,7 @@ int main(int argc, char *argv[])
     _mm_free(seqResult);
     _mm_free(parResult);
 
+    MPI_Comm_free(&splitComm);
     MPI_Finalize();
 
     return EXIT_SUCCESS;